@@ -0,0 +1,80 @@
+#include "alloc.h"
+
+#include <new>
+
+#include <stdlib.h>
+
+std::atomic<bool> alloc_track_on(false);
+
+// zero initialized, no constructor so it is usable from operator new at any time
+static thread_local alloc_count_t alloc_count_local;
+
+const alloc_count_t& alloc_count()
+{
+	return alloc_count_local;
+}
+
+static void* alloc(size_t size)
+{
+	if (alloc_track_on.load(std::memory_order_relaxed))
+	{
+		alloc_count_local.alloc_cnt++;
+		alloc_count_local.alloc_bytes += size;
+	}
+	return malloc(size == 0 ? 1 : size);
+}
+
+static void alloc_free(void* ptr)
+{
+	if (ptr == nullptr)
+		return;
+	if (alloc_track_on.load(std::memory_order_relaxed))
+		alloc_count_local.free_cnt++;
+	free(ptr);
+}
+
+void* operator new(size_t size)
+{
+	void* ptr = alloc(size);
+	if (ptr == nullptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void* operator new[](size_t size)
+{
+	void* ptr = alloc(size);
+	if (ptr == nullptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return alloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return alloc(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+	alloc_free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	alloc_free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+	alloc_free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+	alloc_free(ptr);
+}
@@ -0,0 +1,25 @@
+#ifndef ALLOC_H
+#define ALLOC_H
+
+#include <atomic>
+
+#include <stdint.h>
+
+// Heap allocation counting, off until alloc_track_on is set.
+// operator new/delete (alloc.cpp) count into the calling thread's alloc_count_t,
+// PROFILE_ZONE scopes and game_t::pkt_handle() read it before and after to attribute
+// allocations to zones and packet types.
+
+struct alloc_count_t
+{
+	uint64_t alloc_cnt;
+	uint64_t alloc_bytes;
+	uint64_t free_cnt;
+};
+
+extern std::atomic<bool> alloc_track_on;
+
+// calling thread's counters since it started, they only grow while tracking is on
+const alloc_count_t& alloc_count();
+
+#endif  // ALLOC_H
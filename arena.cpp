@@ -0,0 +1,44 @@
+#include "arena.h"
+
+#include <algorithm>
+
+const size_t frame_arena_t::chunk_size_min;
+
+frame_arena_t::frame_arena_t()
+: chunk_list()
+, pos(nullptr)
+, end(nullptr)
+, used_full(0)
+{
+}
+
+void* frame_arena_t::alloc(size_t size, size_t align)
+{
+	uint8_t* ptr = reinterpret_cast<uint8_t*>((reinterpret_cast<uintptr_t>(pos) + align - 1) & ~(align - 1));
+	if (pos == nullptr || ptr + size > end)
+	{
+		if (!chunk_list.empty())
+			used_full += pos - chunk_list.back().buf.get();
+		const size_t chunk_size = std::max(chunk_size_min, size + align);
+		chunk_list.push_back(chunk_t{std::unique_ptr<uint8_t[]>(new uint8_t[chunk_size]), chunk_size});
+		pos = chunk_list.back().buf.get();
+		end = pos + chunk_size;
+		ptr = reinterpret_cast<uint8_t*>((reinterpret_cast<uintptr_t>(pos) + align - 1) & ~(align - 1));
+	}
+	pos = ptr + size;
+	return ptr;
+}
+
+void frame_arena_t::reset()
+{
+	if (chunk_list.size() > 1)
+	{
+		// room for the next frame to grow and for alignment padding
+		const size_t chunk_size = std::max(chunk_size_min, 2 * (used_full + (pos - chunk_list.back().buf.get())));
+		chunk_list.clear();
+		chunk_list.push_back(chunk_t{std::unique_ptr<uint8_t[]>(new uint8_t[chunk_size]), chunk_size});
+		end = chunk_list.back().buf.get() + chunk_size;
+	}
+	pos = chunk_list.empty() ? nullptr : chunk_list.back().buf.get();
+	used_full = 0;
+}
@@ -0,0 +1,88 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <memory>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Bump allocator for data that lives until the end of a frame.
+// alloc() moves a pointer, reset() drops everything at once. A frame that outgrows the
+// first chunk chains more, the next reset() replaces them with one chunk large enough
+// for that frame, so steady state frames do not touch the heap.
+// Not thread safe: game_t has one for the draw thread, every draw_list_t one for its job.
+struct frame_arena_t
+{
+	static const size_t chunk_size_min = 64 * 1024;
+
+	frame_arena_t();
+
+	void* alloc(size_t size, size_t align);
+
+	template <typename T>
+	T* alloc_array(size_t count)
+	{
+		return static_cast<T*>(alloc(count * sizeof(T), alignof(T)));
+	}
+
+	void reset();
+
+	struct chunk_t
+	{
+		std::unique_ptr<uint8_t[]> buf;
+		size_t size;
+	};
+
+	std::vector<chunk_t> chunk_list;
+	uint8_t* pos;  // in chunk_list.back()
+	uint8_t* end;
+	size_t used_full;  // in the chunks before the last
+};
+
+// STL allocator on a frame_arena_t, deallocate() does nothing
+template <typename T>
+struct arena_allocator_t
+{
+	typedef T value_type;
+
+	explicit arena_allocator_t(frame_arena_t& arena_)
+	: arena(&arena_)
+	{
+	}
+
+	template <typename U>
+	arena_allocator_t(const arena_allocator_t<U>& other)
+	: arena(other.arena)
+	{
+	}
+
+	T* allocate(size_t count)
+	{
+		return arena->alloc_array<T>(count);
+	}
+
+	void deallocate(T*, size_t)
+	{
+	}
+
+	frame_arena_t* arena;
+};
+
+template <typename T, typename U>
+bool operator == (const arena_allocator_t<T>& a, const arena_allocator_t<U>& b)
+{
+	return a.arena == b.arena;
+}
+
+template <typename T, typename U>
+bool operator != (const arena_allocator_t<T>& a, const arena_allocator_t<U>& b)
+{
+	return a.arena != b.arena;
+}
+
+// reserve() up front, growing leaves the old buffer in the arena until reset()
+template <typename T>
+using arena_vector_t = std::vector<T, arena_allocator_t<T>>;
+
+#endif  // ARENA_H
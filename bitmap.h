@@ -0,0 +1,50 @@
+#ifndef BITMAP_H
+#define BITMAP_H
+
+#include <array>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 1 bit per pixel, row after row, pixel idx = y * WIDTH + x
+// bit (idx % 64) of word (idx / 64) holds pixel idx
+template <size_t WIDTH, size_t HEIGHT>
+struct bitmap_t
+{
+	static const size_t width = WIDTH;
+	static const size_t height = HEIGHT;
+	static const size_t bit_count = WIDTH * HEIGHT;
+	static const size_t word_bits = 64;
+	static const size_t word_count = (bit_count + word_bits - 1) / word_bits;
+
+	void clear()
+	{
+		word_list.fill(0);
+	}
+
+	bool get(size_t idx) const
+	{
+		return (word_list[idx / word_bits] >> (idx % word_bits)) & 1;
+	}
+
+	// or up to 64 bits into the bitmap starting at pixel idx, bit 0 of bits goes to idx
+	// bits past the end of the bitmap are dropped
+	void set_bits(size_t idx, uint64_t bits, size_t count)
+	{
+		if (idx >= bit_count || count == 0)
+			return;
+		if (count > bit_count - idx)
+			count = bit_count - idx;
+		if (count < word_bits)
+			bits &= (uint64_t(1) << count) - 1;
+		const size_t word_idx = idx / word_bits;
+		const size_t shift = idx % word_bits;
+		word_list[word_idx] |= bits << shift;
+		if (shift != 0 && shift + count > word_bits)
+			word_list[word_idx + 1] |= bits >> (word_bits - shift);
+	}
+
+	std::array<uint64_t, word_count> word_list;
+};
+
+#endif  // BITMAP_H
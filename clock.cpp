@@ -1,5 +1,89 @@
 #include "clock.h"
 
+#include <cstdio>
+#include <cstring>
+
+#ifdef CLOCK_TSC
+#include <cpuid.h>
+#endif
+
+clock_tsc_t clock_tsc;
+
+#ifdef CLOCK_TSC
+static const uint64_t calibrate_ns = 10000000;
+
+// invariant TSC runs at a constant rate in all power states, the kernel keeps it as
+// clocksource only when it is also synchronized between CPUs
+static bool tsc_usable()
+{
+	unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+	if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || (edx & (1 << 8)) == 0)
+		return false;
+	FILE* fh = fopen("/sys/devices/system/clocksource/clocksource0/current_clocksource", "r");
+	if (fh == nullptr)
+		return false;
+	char name[32] = {};
+	const bool ret = fgets(name, sizeof(name), fh) != nullptr && strcmp(name, "tsc\n") == 0;
+	fclose(fh);
+	return ret;
+}
+
+struct tsc_sample_t
+{
+	uint64_t tsc;
+	uint64_t ns;
+};
+
+// the read between the two closest CLOCK_MONOTONIC reads of a few tries
+static tsc_sample_t tsc_sample()
+{
+	tsc_sample_t sample{0, 0};
+	uint64_t gap_min = UINT64_MAX;
+	for (int idx = 0; idx < 16; ++idx)
+	{
+		const uint64_t ns0 = clock_mono_ns();
+		const uint64_t tsc = __rdtsc();
+		const uint64_t ns1 = clock_mono_ns();
+		if (ns1 - ns0 < gap_min)
+		{
+			gap_min = ns1 - ns0;
+			sample = tsc_sample_t{tsc, ns0 + (ns1 - ns0) / 2};
+		}
+	}
+	return sample;
+}
+#endif
+
+void clock_start()
+{
+#ifdef CLOCK_TSC
+	if (clock_tsc.mult != 0 || !tsc_usable())
+		return;
+	const tsc_sample_t begin = tsc_sample();
+	const struct timespec wait = {0, static_cast<long>(calibrate_ns)};
+	nanosleep(&wait, nullptr);
+	const tsc_sample_t end = tsc_sample();
+	const uint64_t ticks = end.tsc - begin.tsc;
+	const uint64_t ns = end.ns - begin.ns;
+	// 100 MHz - 10 GHz, anything else is a broken sample
+	if (ns < calibrate_ns || ticks < ns / 10 || ticks > ns * 10)
+		return;
+	clock_tsc.base_tsc = end.tsc;
+	clock_tsc.base_ns = end.ns;
+	clock_tsc.mult = static_cast<uint64_t>((static_cast<unsigned __int128>(ns) << 32) / ticks);
+#endif
+}
+
+const char* clock_source()
+{
+	return clock_tsc.mult != 0 ? "tsc" : "monotonic";
+}
+
+double clock_tsc_mhz()
+{
+	return clock_tsc.mult != 0 ? 1000. * (uint64_t(1) << 32) / clock_tsc.mult : 0.;
+}
+
 uint64_t run_time_us()
 {
 	static uint64_t run_start = uptime_us();
@@ -4,16 +4,56 @@
 #include <cstdint>
 #include <ctime>
 
-#include <chrono>
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#define CLOCK_TSC 1
+#endif
 
-static inline uint64_t uptime_us()
+// Monotonic time. After clock_start() found an invariant TSC that the kernel also
+// uses as its clocksource, uptime_ns() is rdtsc scaled by a factor calibrated against
+// CLOCK_MONOTONIC, no vDSO or syscall. Otherwise, and before clock_start(), it is
+// clock_gettime(CLOCK_MONOTONIC). The TSC time starts from a CLOCK_MONOTONIC sample
+// so values from before clock_start() compare with later ones.
+
+struct clock_tsc_t
+{
+	uint64_t base_tsc;
+	uint64_t base_ns;
+	uint64_t mult;  // ns per tick << 32, 0 - TSC not used
+};
+
+// written by clock_start() only
+extern clock_tsc_t clock_tsc;
+
+static inline uint64_t clock_mono_ns()
 {
-	using namespace std::chrono;
 	struct timespec ts = {0, 0};
-	clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
-	return duration_cast<microseconds>(seconds{ts.tv_sec} + nanoseconds{ts.tv_nsec}).count();
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
 }
 
+static inline uint64_t uptime_ns()
+{
+#ifdef CLOCK_TSC
+	if (clock_tsc.mult != 0)
+		return clock_tsc.base_ns + static_cast<uint64_t>(
+			(static_cast<unsigned __int128>(__rdtsc() - clock_tsc.base_tsc) * clock_tsc.mult) >> 32);
+#endif
+	return clock_mono_ns();
+}
+
+static inline uint64_t uptime_us()
+{
+	return uptime_ns() / 1000;
+}
+
+// picks and calibrates the clock, takes ~10 ms, call from main() before starting threads
+void clock_start();
+// "tsc" or "monotonic"
+const char* clock_source();
+// TSC frequency found by clock_start(), 0 when not used
+double clock_tsc_mhz();
+
 uint64_t run_time_us();
 
 #endif  // CLOCK_H
@@ -0,0 +1,55 @@
+#ifndef FIXED_H
+#define FIXED_H
+
+#include <cmath>
+
+#include <stdint.h>
+
+// Signed fixed point number with FRAC fractional bits in an int32_t.
+// fixed_t<12> holds +-524287 in 1/4096 steps, 16.16 would not cover the 43200 wide game field.
+template <unsigned FRAC>
+struct fixed_t
+{
+	static const unsigned frac_bits = FRAC;
+	static const int32_t one = int32_t(1) << FRAC;
+
+	fixed_t() = default;
+	fixed_t(int32_t val) : raw(val * one) {}
+	explicit fixed_t(double val) : raw(static_cast<int32_t>(std::floor(val * one + 0.5))) {}
+	static fixed_t from_raw(int32_t raw)
+	{
+		fixed_t val;
+		val.raw = raw;
+		return val;
+	}
+
+	// round to nearest whole unit
+	int32_t to_int() const { return (raw + one / 2) >> FRAC; }
+	float to_float() const { return static_cast<float>(raw) / one; }
+
+	fixed_t operator - () const { return from_raw(-raw); }
+	fixed_t& operator += (fixed_t other) { raw += other.raw; return *this; }
+	fixed_t& operator -= (fixed_t other) { raw -= other.raw; return *this; }
+
+	// friends so that an int converts on either side
+	friend fixed_t operator + (fixed_t a, fixed_t b) { return from_raw(a.raw + b.raw); }
+	friend fixed_t operator - (fixed_t a, fixed_t b) { return from_raw(a.raw - b.raw); }
+	friend fixed_t operator * (fixed_t a, fixed_t b)
+	{
+		return from_raw((static_cast<int64_t>(a.raw) * b.raw) >> FRAC);
+	}
+	friend fixed_t operator / (fixed_t a, fixed_t b)
+	{
+		return from_raw((static_cast<int64_t>(a.raw) << FRAC) / b.raw);
+	}
+	friend bool operator == (fixed_t a, fixed_t b) { return a.raw == b.raw; }
+	friend bool operator != (fixed_t a, fixed_t b) { return a.raw != b.raw; }
+	friend bool operator < (fixed_t a, fixed_t b) { return a.raw < b.raw; }
+	friend bool operator > (fixed_t a, fixed_t b) { return a.raw > b.raw; }
+	friend bool operator <= (fixed_t a, fixed_t b) { return a.raw <= b.raw; }
+	friend bool operator >= (fixed_t a, fixed_t b) { return a.raw >= b.raw; }
+
+	int32_t raw;
+};
+
+#endif  // FIXED_H
@@ -8,14 +8,23 @@
 #include <cmath>
 
 #include "game.h"
+#include "alloc.h"
 #include "packet_to_client.h"
 #include "packet_to_server.h"
 #include "log.h"
+#include "profile.h"
 
-game_t::game_t(screen_sdl_t& screen_)
+game_t::game_t(screen_t& screen_)
 : config()
 , screen(screen_)
 , draw_ctx()
+, draw_stat()
+, draw_quality()
+, draw_quality_base()
+, quality_governor()
+, minimap_tstamp(0)
+, pkt_rx_us(0)
+, frame_now_us(0)
 , pkt_handler_list()
 , have_data(false)
 , my_snake_id(game_t::snake_id_invalid)
@@ -25,16 +34,45 @@ game_t::game_t(screen_sdl_t& screen_)
 , snake_id_list()
 , prey_list()
 , minimap()
-, edge_points()
+, minimap_updated(false)
+, edge_lod_list()
+, edge_arc()
+, kinematics()
+, kinematics_snake_list()
+, job_system()
+, draw_list_pool()
+, frame_arena()
+, snake_draw_list(nullptr)
+, prepare_now_us(0)
+, snake_draw_list_count(0)
+, food_draw_list_count(0)
+, xy_screen_buf()
+, xy_idx_buf()
 , leaderboard()
 , score()
 , fps(0)
+, profile_overlay(false)
+, pkt_type_cur(0)
+, pkt_stat()
+, pkt_stat_last()
+, pkt_stat_prev()
+, pkt_stat_lock()
+, pkt_stat_snap()
+, snap()
 , ping_ctx()
+, send_spacing()
+, watchdog(draw_period_us)
 {
 	pkt_handle_init();
 	config.game_radius = game_radius;
 	config.sector_size = sector_size;
 	config.mscps = snake_max_part_count;
+	draw_quality_base.part_lod = part_lod_default;
+	draw_quality_base.names = true;
+	draw_quality_base.render_scale = 1.;
+	quality_governor.enabled = true;
+	draw_quality_apply();
+	draw_ctx.zoom = 1.;
 	edge_points_calc();
 	score.set_mscps(config.mscps);
 }
@@ -80,23 +118,102 @@ void game_t::pkt_handle_init()
 	pkt_handler_list['v'] = &game_t::pkt_end;
 }
 
-void game_t::pkt_handle(const uint8_t* buf, size_t size)
+// trace event names per packet type, they have to outlive the trace
+struct pkt_trace_name_list_t
 {
-	if (size < sizeof(pkt_hdr_t)){ LOG("wrong size:%zu", size); return; }
+	pkt_trace_name_list_t()
+	{
+		for (size_t type = 0; type < 256; ++type)
+			if (isalnum(type))
+				snprintf(name_list[type], sizeof(name_list[type]), "pkt_%c", static_cast<char>(type));
+			else
+				snprintf(name_list[type], sizeof(name_list[type]), "pkt_0x%02zx", type);
+	}
+
+	char name_list[256][12];
+};
+
+// handler size check failed, counted per packet type as LOG is compiled out by default
+#define PKT_REJECT(...) do{ \
+				pkt_stat.type_list[pkt_type_cur].reject++; \
+				LOG(__VA_ARGS__); \
+				}while(0)
+
+static const char* pkt_trace_name(uint8_t pkt_type)
+{
+	static const pkt_trace_name_list_t pkt_trace_name_list;
+	return pkt_trace_name_list.name_list[pkt_type];
+}
+
+void game_t::pkt_handle(const uint8_t* buf, size_t size, uint64_t rx_us)
+{
+	PROFILE_ZONE("pkt_handle");
+	if (size < sizeof(pkt_hdr_t)){ pkt_stat.short_cnt++; LOG("wrong size:%zu", size); return; }
 	pkt_hdr_t pkt_hdr;
 	memcpy(&pkt_hdr, buf, sizeof(pkt_hdr));
 	const uint8_t pkt_type = static_cast<uint8_t>(pkt_hdr.packet_type);
 	buf += sizeof(pkt_hdr_t);
 	size -= sizeof(pkt_hdr_t);
+	pkt_rx_us = rx_us;
+	send_spacing.add(be16toh(pkt_hdr.client_time), pkt_rx_us);
+	pkt_type_stat_t& type_stat = pkt_stat.type_list[pkt_type];
+	type_stat.count++;
+	type_stat.bytes += size;
 	if (pkt_handler_list[pkt_type] == nullptr)
 	{
+		type_stat.reject++;
 		LOG(" unknown packet:%c", static_cast<char>(pkt_type));
 		return;
 	}
+	pkt_type_cur = pkt_type;
+	const alloc_count_t* alloc_start = alloc_track_on.load(std::memory_order_relaxed) ? &alloc_count() : nullptr;
+	const alloc_count_t alloc_begin = alloc_start != nullptr ? *alloc_start : alloc_count_t{};
+	const uint64_t begin_ns = uptime_ns();
 	(this->*(pkt_handler_list[pkt_type]))(buf, size);
+	const uint64_t end_ns = uptime_ns();
+	type_stat.decode_ns += end_ns - begin_ns;
+	watchdog.pkt(pkt_type, end_ns - begin_ns);
+	if (alloc_start != nullptr)
+	{
+		type_stat.alloc_cnt += alloc_start->alloc_cnt - alloc_begin.alloc_cnt;
+		type_stat.alloc_bytes += alloc_start->alloc_bytes - alloc_begin.alloc_bytes;
+	}
+	if (trace_on.load(std::memory_order_relaxed))
+		trace_event(pkt_trace_name(pkt_type), begin_ns, end_ns);
 	have_data = true;
 }
 
+// once per second from draw(), pkt_stat_snap is what other threads read
+void game_t::pkt_stat_snapshot()
+{
+	pkt_stat_prev = pkt_stat_last;
+	pkt_stat_last = pkt_stat;
+	game_snap_t snap_new{};
+	for (const profile_zone_t* zone : profile_zone_list())
+	{
+		if (strcmp(zone->name, "frame_gap") == 0)
+			snap_new.frame_stat = zone->stat;
+		else if (strcmp(zone->name, "draw") == 0)
+			snap_new.draw_stat = zone->stat;
+	}
+	snap_new.frame_cnt = watchdog.frame_cnt;
+	snap_new.slow_cnt = watchdog.slow_cnt;
+	snap_new.queue_depth = watchdog.queue_depth;
+	snap_new.rtt_p50_us = ping_ctx.rtt.percentile_us(0.5);
+	snap_new.rtt_p99_us = ping_ctx.rtt.percentile_us(0.99);
+	snap_new.ping_cnt = ping_ctx.ping_cnt;
+	snap_new.ping_lost_cnt = ping_ctx.lost_cnt;
+	snap_new.text_cache_cnt = screen.text_cache_size();
+	snap_new.texture_cnt = screen.texture_cnt;
+	snap_new.snake_cnt = snake_id_list.size();
+	snap_new.food_cnt = food_list.size();
+	snap_new.prey_cnt = prey_list.size();
+	snap_new.sector_cnt = sector_list.size();
+	std::lock_guard<std::mutex> lock_guard(pkt_stat_lock);
+	pkt_stat_snap = pkt_stat;
+	snap = snap_new;
+}
+
 void game_t::pkt_send(pkt_sender_t sender)
 {
 	float ang;
@@ -106,12 +223,10 @@ void game_t::pkt_send(pkt_sender_t sender)
 		return;
 
 	uint64_t now_us = uptime_us();
-	if (now_us - ping_ctx.ping_tstamp >= ping_period_us &&
-		!ping_ctx.wait_pong)
+	if (ping_ctx.ping_due(now_us))
 	{
 		uint8_t ping = 251;
-		ping_ctx.ping_tstamp = now_us;
-		ping_ctx.wait_pong = true;
+		ping_ctx.ping(now_us);
 		sender(ping);
 	}
 
@@ -154,7 +269,7 @@ void game_t::pkt_send(pkt_sender_t sender)
 
 void game_t::pkt_init(const uint8_t* buf, size_t size)
 {
-	if (size < sizeof(pkt_init_t)){ LOG("wrong size:%zu", size); return; }
+	if (size < sizeof(pkt_init_t)){ PKT_REJECT("wrong size:%zu", size); return; }
 	pkt_init_t pkt;
 	memcpy(&pkt, buf, sizeof(pkt));
 	LOG("%u %u %u %u %u %u %u %u %u %u %u %u",
@@ -172,6 +287,8 @@ void game_t::pkt_init(const uint8_t* buf, size_t size)
 		pkt.protocol_version
 		);
 
+	const coordinate_t game_radius_prev = config.game_radius;
+	const coordinate_t sector_size_prev = config.sector_size;
 	config.game_radius = be24toh(pkt.game_radius);
 	config.mscps = be16toh(pkt.mscps); // maximum snake length in body parts units
 	config.sector_size = be16toh(pkt.sector_size);
@@ -185,15 +302,15 @@ void game_t::pkt_init(const uint8_t* buf, size_t size)
 	config.protocol_version = pkt.protocol_version;
 
 	score.set_mscps(config.mscps);
-	if (config.game_radius != game_radius ||
-		config.sector_size != sector_size)
+	if (config.game_radius != game_radius_prev ||
+		config.sector_size != sector_size_prev)
 		edge_points_calc();
 }
 
 // W
 void game_t::pkt_sector_add(const uint8_t* buf, size_t size)
 {
-	if (size < sizeof(pkt_sector_add_t)){ LOG("wrong size:%zu", size); return; }
+	if (size < sizeof(pkt_sector_add_t)){ PKT_REJECT("wrong size:%zu", size); return; }
 	pkt_sector_add_t pkt;
 	memcpy(&pkt, buf, sizeof(pkt));
 	sector_list.push_back(xy_t{pkt.x, pkt.y});
@@ -203,7 +320,7 @@ void game_t::pkt_sector_add(const uint8_t* buf, size_t size)
 // w
 void game_t::pkt_sector_rem(const uint8_t* buf, size_t size)
 {
-	if (size < sizeof(pkt_sector_rem_t)){ LOG("wrong size:%zu", size); return; }
+	if (size < sizeof(pkt_sector_rem_t)){ PKT_REJECT("wrong size:%zu", size); return; }
 	pkt_sector_rem_t pkt;
 	memcpy(&pkt, buf, sizeof(pkt));
 	const xy_t sect_to_rm{pkt.x, pkt.y};
@@ -240,7 +357,7 @@ void game_t::pkt_food_set(const uint8_t* buf, size_t size)
 // f b
 void game_t::pkt_food_add(const uint8_t* buf, size_t size)
 {
-	if (size < sizeof(pkt_food_set_t)){ LOG("wrong size:%zu", size); return; }
+	if (size < sizeof(pkt_food_set_t)){ PKT_REJECT("wrong size:%zu", size); return; }
 	pkt_food_set_t pkt;
 	memcpy(&pkt, buf, sizeof(pkt));
 	LOG("%u %u %u %u", pkt.color, be16toh(pkt.x), be16toh(pkt.y), pkt.size / 5);
@@ -254,7 +371,7 @@ void game_t::pkt_food_add(const uint8_t* buf, size_t size)
 // c
 void game_t::pkt_food_eat(const uint8_t* buf, size_t size)
 {
-	if (size < sizeof(pkt_food_eat_t)){ LOG("wrong size:%zu", size); return; }
+	if (size < sizeof(pkt_food_eat_t)){ PKT_REJECT("wrong size:%zu", size); return; }
 	pkt_food_eat_t pkt;
 	memcpy(&pkt, buf, sizeof(pkt));
 	xy_t xy{be16toh(pkt.x), be16toh(pkt.y)};
@@ -267,20 +384,20 @@ void game_t::pkt_food_eat(const uint8_t* buf, size_t size)
 // g
 void game_t::pkt_snake_mov(const uint8_t* buf, size_t size)
 {
-	if (size < sizeof(pkt_snake_mov_t)){ LOG("wrong size:%zu", size); return; }
+	if (size < sizeof(pkt_snake_mov_t)){ PKT_REJECT("wrong size:%zu", size); return; }
 	pkt_snake_mov_t pkt;
 	memcpy(&pkt, buf, sizeof(pkt));
 	size_t snake_id = be16toh(pkt.snake_id);
 	snake_t& snake = snake_get(snake_id);
 	if (my_snake_id == snake_id_invalid)
 		my_snake_id = snake_id;
-	snake.move(xy_t{be16toh(pkt.x), be16toh(pkt.y)});
+	snake.move(xy_t{be16toh(pkt.x), be16toh(pkt.y)}, pkt_rx_us);
 	LOG("%zu %s", snake_id, to_str(snake.part_list[0]).c_str());
 }
 
 void game_t::pkt_snake_mov_G(const uint8_t* buf, size_t size)
 {
-	if (size < sizeof(pkt_snake_mov_G_t)){ LOG("wrong size:%zu", size); return; }
+	if (size < sizeof(pkt_snake_mov_G_t)){ PKT_REJECT("wrong size:%zu", size); return; }
 	pkt_snake_mov_G_t pkt;
 	memcpy(&pkt, buf, sizeof(pkt));
 	size_t snake_id = be16toh(pkt.snake_id);
@@ -290,28 +407,28 @@ void game_t::pkt_snake_mov_G(const uint8_t* buf, size_t size)
 	if (snake.part_list.empty())
 		return;
 
-	xy_t head{snake.part_list.front()};
+	xy_t head = xy_int(snake.part_list.front());
 	head.x += pkt.x - 128;
 	head.y += pkt.y - 128;
 	LOG("%zu %s", snake_id, to_str(head).c_str());
-	snake.move(head);
+	snake.move(head, pkt_rx_us);
 }
 
 // N
 void game_t::pkt_snake_mov_inc(const uint8_t* buf, size_t size)
 {
-	if (size != sizeof(pkt_snake_mov_inc_t)){ LOG("wrong size:%zu", size); return; }
+	if (size != sizeof(pkt_snake_mov_inc_t)){ PKT_REJECT("wrong size:%zu", size); return; }
 	pkt_snake_mov_inc_t pkt;
 	memcpy(&pkt, buf, sizeof(pkt));
 	size_t snake_id = be16toh(pkt.snake_id);
 	snake_t& snake = snake_get(snake_id);
 	snake.snake_length++;
 
-	xy_t head{snake.part_list.front()};
+	xy_t head = xy_int(snake.part_list.front());
 	head.x += pkt.x - 128;
 	head.y += pkt.y - 128;
 	LOG("%zu %s length:%zu", snake_id, to_str(head).c_str(), snake.snake_length);
-	snake.move(head);
+	snake.move(head, pkt_rx_us);
 }
 
 // e
@@ -353,7 +470,7 @@ void game_t::pkt_snake_rot_e(const uint8_t* buf, size_t size)
 			break;
 		}
 		default:
-			LOG("wrong size:%zu", size);
+			PKT_REJECT("wrong size:%zu", size);
 			return;
 	}
 	LOG("size:%zu %zu angle:%f wangle:%f speed:%f", size, snake_id, angle, wangle, speed);
@@ -369,7 +486,7 @@ void game_t::pkt_snake_rot_e(const uint8_t* buf, size_t size)
 // 3
 void game_t::pkt_snake_rot_3(const uint8_t* buf, size_t size)
 {
-	if (size != sizeof(pkt_snake_rot_5_t)){ LOG("wrong size:%zu", size); return; }
+	if (size != sizeof(pkt_snake_rot_5_t)){ PKT_REJECT("wrong size:%zu", size); return; }
 	pkt_snake_rot_5_t pkt;
 	memcpy(&pkt, buf, sizeof(pkt));
 	size_t snake_id = be16toh(pkt.snake_id);
@@ -385,7 +502,7 @@ void game_t::pkt_snake_rot_3(const uint8_t* buf, size_t size)
 
 void game_t::pkt_snake_rot_4(const uint8_t* buf, size_t size)
 {
-	if (size != sizeof(pkt_snake_rot_4_5_t)){ LOG("wrong size:%zu", size); return; }
+	if (size != sizeof(pkt_snake_rot_4_5_t)){ PKT_REJECT("wrong size:%zu", size); return; }
 	pkt_snake_rot_4_5_t pkt;
 	memcpy(&pkt, buf, sizeof(pkt));
 	size_t snake_id = be16toh(pkt.snake_id);
@@ -402,7 +519,7 @@ void game_t::pkt_snake_rot_4(const uint8_t* buf, size_t size)
 
 void game_t::pkt_snake_rot_5(const uint8_t* buf, size_t size)
 {
-	if (size != sizeof(pkt_snake_rot_5_t)){ LOG("wrong size:%zu", size); return; }
+	if (size != sizeof(pkt_snake_rot_5_t)){ PKT_REJECT("wrong size:%zu", size); return; }
 	pkt_snake_rot_5_t pkt;
 	memcpy(&pkt, buf, sizeof(pkt));
 	size_t snake_id = be16toh(pkt.snake_id);
@@ -415,7 +532,7 @@ void game_t::pkt_snake_rot_5(const uint8_t* buf, size_t size)
 // n
 void game_t::pkt_snake_inc(const uint8_t* buf, size_t size)
 {
-	if (size < sizeof(pkt_snake_inc_t)){ LOG("wrong size:%zu", size); return; }
+	if (size < sizeof(pkt_snake_inc_t)){ PKT_REJECT("wrong size:%zu", size); return; }
 	pkt_snake_inc_t pkt;
 	memcpy(&pkt, buf, sizeof(pkt));
 	size_t snake_id = be16toh(pkt.snake_id);
@@ -423,7 +540,7 @@ void game_t::pkt_snake_inc(const uint8_t* buf, size_t size)
 	snake.snake_length++;
 	snake.fam = 1. * be24toh(pkt.fam) / 16777215;
 
-	snake.move(xy_t{be16toh(pkt.x), be16toh(pkt.y)});
+	snake.move(xy_t{be16toh(pkt.x), be16toh(pkt.y)}, pkt_rx_us);
 
 	LOG("%zu %s fam:%f",
 		snake_id,
@@ -445,7 +562,7 @@ void game_t::pkt_snake(const uint8_t* buf, size_t size)
 			snake_get(snake_id).dead = true;
 			if (snake_id == my_snake_id)
 			{
-				LOG("my snake dead");
+				LOG_INFO("my snake dead");
 			}
 		}
 		if (snake_id != my_snake_id)
@@ -456,7 +573,7 @@ void game_t::pkt_snake(const uint8_t* buf, size_t size)
 		return;
 	}
 
-	if (size < sizeof(pkt_snake_data_t)){ LOG("wrong size:%zu", size); return; }
+	if (size < sizeof(pkt_snake_data_t)){ PKT_REJECT("wrong size:%zu", size); return; }
 	pkt_snake_data_t pkt;
 	memcpy(&pkt, buf, sizeof(pkt));
 	size_t snake_id = be16toh(pkt.snake_id);
@@ -485,15 +602,16 @@ void game_t::pkt_snake(const uint8_t* buf, size_t size)
 	snake.rot_angle = 1. * be24toh(pkt.angle) * M_PI * 2 / 16777215;
 	snake.rot_wangle = 1. * be24toh(pkt.wangle) * M_PI * 2 / 16777215;
 	snake.speed = 1. * be16toh(pkt.speed) / 1000;
-	strncpy(snake.name, name, sizeof(snake.name) - 1);
+	// clear() zeroed the name, the copy keeps its terminator
+	memcpy(snake.name, name, std::min(name_len, sizeof(snake.name) - 1));
 
 	if (snake_id_list.end() == std::find(snake_id_list.begin(), snake_id_list.end(), snake_id))
 		snake_id_list.push_back(snake_id);
 
 	snake.skin = pkt.skin;
-	snake.tstamp_data = uptime_us();
+	snake.tstamp_data = pkt_rx_us;
 	if (snake.head == xy_t{0, 0} && !snake.part_list.empty())
-		snake.head = snake.part_list[0];
+		snake.head = xy_int(snake.part_list[0]);
 
 	std::deque<xy_t> new_part_list;
 	new_part_list.push_front(tail);
@@ -513,14 +631,15 @@ void game_t::pkt_snake(const uint8_t* buf, size_t size)
 	}
 	new_part_list.push_back(head);
 	for (xy_t part : new_part_list)
-		snake.part_list.push_back(part);
+		snake.part_list.push_back(part_xy_t{part.x, part.y});
+	snake.bbox_calc();
 	snake.snake_length = snake.part_list.size();
-	snake.head = snake.part_list[0];
+	snake.head = xy_int(snake.part_list[0]);
 
 	if (my_snake_id == snake_id_invalid)
 	{
 		my_snake_id = snake_id;
-		draw_ctx_update();
+		draw_ctx_update(pkt_rx_us);
 	}
 }
 
@@ -585,7 +704,7 @@ void game_t::pkt_prey(const uint8_t* buf, size_t size)
 			prey.rot_wangle = 1. * be24toh(pkt.wangle) * M_PI * 2 / 16777215;
 			prey.speed = be16toh(pkt.wangle) / 1000;
 			prey.dir = static_cast<rot_dir_t>(pkt.dir - 48);
-			prey.tstamp_data = uptime_us();
+			prey.tstamp_data = pkt_rx_us;
 			prey_list.emplace_back(prey);
 			LOG(" prey.id:%zu %s size:%d color:%d rot_angle:%f rot_wangle:%f speed:%f dir:%d",
 				prey.id, to_str(prey.xy).c_str(), prey.size, prey.color,
@@ -594,7 +713,7 @@ void game_t::pkt_prey(const uint8_t* buf, size_t size)
 		}
 
 		default:
-			LOG("wrong size:%zu", size);
+			PKT_REJECT("wrong size:%zu", size);
 			return;
 	}
 }
@@ -602,7 +721,7 @@ void game_t::pkt_prey(const uint8_t* buf, size_t size)
 // j
 void game_t::pkt_prey_upd(const uint8_t* buf, size_t size)
 {
-	if (size < sizeof(pkt_prey_upd_t)){ LOG("wrong size:%zu", size); return; }
+	if (size < sizeof(pkt_prey_upd_t)){ PKT_REJECT("wrong size:%zu", size); return; }
 	pkt_prey_upd_t pkt;
 	memcpy(&pkt, buf, sizeof(pkt));
 	size_t prey_id = be16toh(pkt.prey_id);
@@ -615,7 +734,7 @@ void game_t::pkt_prey_upd(const uint8_t* buf, size_t size)
 	prey_t& prey = *prey_it;
 	prey.xy_prev = prey.xy;
 	prey.xy = xy_t{be16toh(pkt.x) * 3 + 1, be16toh(pkt.y) * 3 + 1};
-	uint64_t now_us = uptime_us();
+	const uint64_t now_us = pkt_rx_us;
 	prey.tstamp_data = now_us;
 	ssize_t size_ext = size - sizeof(pkt_prey_upd_t);
 	buf += sizeof(pkt_prey_upd_t);
@@ -685,7 +804,7 @@ void game_t::pkt_prey_upd(const uint8_t* buf, size_t size)
 			break;
 		}
 		default:
-			LOG("wrong size_ext:%zu", size_ext);
+			PKT_REJECT("wrong size_ext:%zu", size_ext);
 			return;
 	}
 	if (angle != invalid_angle)
@@ -705,16 +824,16 @@ void game_t::pkt_prey_upd(const uint8_t* buf, size_t size)
 // v
 void game_t::pkt_end(const uint8_t* buf, size_t size)
 {
-	if (size < 1){ LOG("wrong size:%zu", size); return; }
+	if (size < 1){ PKT_REJECT("wrong size:%zu", size); return; }
 	snake_get(my_snake_id).dead = true;
 	(void)buf;
-	LOG("my snake dead reason:%u", buf[0]);
+	LOG_INFO("my snake dead reason:%u", buf[0]);
 }
 
 // h
 void game_t::pkt_snake_fam(const uint8_t* buf, size_t size)
 {
-	if (size < sizeof(pkt_snake_fam_t)){ LOG("wrong size:%zu", size); return; }
+	if (size < sizeof(pkt_snake_fam_t)){ PKT_REJECT("wrong size:%zu", size); return; }
 	// 	Update the fam-value (used for length-calculation) of a snake.
 	// 	fam is a float value (usually in [0 .. 1.0]) representing a
 	// 	body part ratio before changing snake length sct in body parts.
@@ -730,7 +849,7 @@ void game_t::pkt_snake_fam(const uint8_t* buf, size_t size)
 // r
 void game_t::pkt_snake_rem_part(const uint8_t* buf, size_t size)
 {
-	if (size < sizeof(pkt_snake_fam_t)){ LOG("wrong size:%zu", size); return; }
+	if (size < sizeof(pkt_snake_fam_t)){ PKT_REJECT("wrong size:%zu", size); return; }
 	pkt_snake_fam_t pkt;
 	memcpy(&pkt, buf, sizeof(pkt));
 	size_t snake_id = be16toh(pkt.snake_id);
@@ -743,40 +862,55 @@ void game_t::pkt_snake_rem_part(const uint8_t* buf, size_t size)
 	snake.part_list_trim();
 }
 
+static std::array<uint8_t, 128> bit7_reverse_table_make()
+{
+	std::array<uint8_t, 128> table{};
+	for (size_t value = 0; value < table.size(); ++value)
+		for (size_t bit = 0; bit < 7; ++bit)
+			if (value & (1 << (6 - bit)))
+				table[value] |= 1 << bit;
+	return table;
+}
+
 // u
 void game_t::pkt_minimap(const uint8_t* buf, size_t size)
 {
+	// byte >= 128: skip (byte - 128) pixels
+	// byte < 128: 7 pixels, most significant bit first
+	// literal bytes are packed into one word and written with a single set_bits()
+	static const std::array<uint8_t, 128> bit7_reverse = bit7_reverse_table_make();
 	LOG(" size:%zu", size);
-	const uint8_t* data = buf;
-	minimap = {};
-	size_t mapPos = 0;
-	for (size_t dataPos = 0; dataPos < size; dataPos++)
+	minimap.clear();
+	size_t map_pos = 0;
+	uint64_t bits = 0;
+	size_t bit_cnt = 0;
+	for (size_t data_pos = 0; data_pos < size; data_pos++)
 	{
-		int32_t value = data[dataPos];
-		if (value >= 128)
+		const uint8_t value = buf[data_pos];
+		if (value < 128)
 		{
-			value -= 128;
-			mapPos += value;
-			if (mapPos > minimap.size())
-				break;
-		} else
-		{
-			for (int i = 0; i < 7; i++)
-			{
-				if ((value & (1 << (6 - i))) != 0)
-					minimap[mapPos] = 1;
-				mapPos++;
-				if (mapPos > minimap.size())
-					break;
-			}
+			bits |= static_cast<uint64_t>(bit7_reverse[value]) << bit_cnt;
+			bit_cnt += 7;
+			if (bit_cnt + 7 <= minimap.word_bits)
+				continue;
 		}
+		minimap.set_bits(map_pos, bits, bit_cnt);
+		map_pos += bit_cnt;
+		bits = 0;
+		bit_cnt = 0;
+		if (value >= 128)
+			map_pos += value - 128;
+		if (map_pos >= minimap.bit_count)
+			break;
 	}
+	minimap.set_bits(map_pos, bits, bit_cnt);
+	minimap_updated = true;
 }
 
 // l
 void game_t::pkt_leaderboard(const uint8_t* buf, size_t size)
 {
-	if (size < sizeof(pkt_leaderboard_t)){ LOG("wrong size:%zu", size); return; }
+	if (size < sizeof(pkt_leaderboard_t)){ PKT_REJECT("wrong size:%zu", size); return; }
 	pkt_leaderboard_t pkt;
 	memcpy(&pkt, buf, sizeof(pkt));
 	leaderboard.rank = be16toh(pkt.rank);
@@ -808,21 +942,28 @@ void game_t::pkt_pong(const uint8_t* buf, size_t size)
 {
 	(void)buf;
 	(void)size;
-	if (ping_ctx.wait_pong == false)
-		return;
-	ping_ctx.wait_pong = false;
-	ping_ctx.ping_pong_us = uptime_us() - ping_ctx.ping_tstamp;
-	ping_ctx.ping_pong_avg_us += ping_ctx.ping_pong_us;
-	ping_ctx.ping_pong_avg_us /= 2;
+	ping_ctx.pong(pkt_rx_us);
 }
 
-bool game_t::draw_ctx_update()
+bool game_t::draw_ctx_update(uint64_t now_us)
 {
 	if (my_snake_id == snake_id_invalid)
 		return false;
 	xy_t game_view_center_prev = draw_ctx.game_view_center;
-	draw_ctx.game_view_center = snake_get(my_snake_id).head;
-	draw_ctx.scale = 0.5;
+	const float scale_prev = draw_ctx.scale;
+	const snake_t& snake = snake_get(my_snake_id);
+	draw_ctx.game_view_center = snake.head;
+
+	const int wheel = screen.mouse_wheel();
+	if (wheel != 0)
+	{
+		draw_ctx.zoom *= std::pow(zoom_step, wheel);
+		draw_ctx.zoom = std::min(std::max(draw_ctx.zoom, zoom_min), zoom_max);
+	}
+	draw_ctx.scale_target = view_scale(snake.snake_length) * draw_ctx.zoom;
+	const float scale_ko = 1. - std::exp(-1. * (now_us - draw_ctx.scale_tstamp) / scale_time_us);
+	draw_ctx.scale += (draw_ctx.scale_target - draw_ctx.scale) * scale_ko;
+	draw_ctx.scale_tstamp = now_us;
 
 	const coordinate_t max_coord = config.game_radius * 2;
 	xy_t ul = {max_coord, max_coord};
@@ -846,7 +987,14 @@ bool game_t::draw_ctx_update()
 	draw_ctx.height = lr.y - ul.y;
 	draw_ctx.game_view_rect = {ul, lr};
 
-	return game_view_center_prev != draw_ctx.game_view_center;
+	const xy_t& ctr = draw_ctx.game_view_center;
+	const coordinate_t half_width = screen.width / 2 / draw_ctx.scale + 1;
+	const coordinate_t half_height = screen.height / 2 / draw_ctx.scale + 1;
+	draw_ctx.screen_rect = {
+		xy_t{ctr.x - half_width, ctr.y - half_height},
+		xy_t{ctr.x + half_width, ctr.y + half_height}};
+
+	return game_view_center_prev != draw_ctx.game_view_center || scale_prev != draw_ctx.scale;
 }
 
 template <typename Txy>
@@ -862,6 +1010,15 @@ xy_t game_t::screen_xy(const Txy& game_xy)
 	return xy;
 }
 
+xy_transform_t game_t::screen_transform()
+{
+	return xy_transform_t{
+		draw_ctx.game_view_center,
+		draw_ctx.scale,
+		xy_t{screen.width / 2, screen.height / 2}
+		};
+}
+
 template <typename Txy>
 xy_t game_t::game_xy(const Txy& screen_xy)
 {
@@ -873,38 +1030,127 @@ xy_t game_t::game_xy(const Txy& screen_xy)
 	return xy;
 }
 
-typedef screen_sdl_t::color_t color_t;
+typedef screen_t::color_t color_t;
 static const color_t white(255, 255, 255);
 static const color_t red(255, 0, 0);
 static const color_t green(0, 255, 0);
 static const color_t blue(0, 0, 255);
 
+// each level keeps the cuts of the levels above it
+void game_t::draw_quality_apply()
+{
+	draw_quality = draw_quality_base;
+	const size_t level = quality_governor.level;
+	if (level >= 1)
+	{
+		draw_quality.part_lod = std::max(draw_quality.part_lod, 0.5f);
+		draw_quality.minimap_period_us = std::max<uint64_t>(draw_quality.minimap_period_us, 500000);
+	}
+	if (level >= 2)
+	{
+		draw_quality.part_lod = std::max(draw_quality.part_lod, 1.f);
+		draw_quality.food_size_min = std::max<coordinate_t>(draw_quality.food_size_min, 2);
+		draw_quality.minimap_period_us = std::max<uint64_t>(draw_quality.minimap_period_us, 1000000);
+		draw_quality.render_scale = std::min(draw_quality.render_scale, 0.75f);
+	}
+	if (level >= 3)
+	{
+		draw_quality.part_lod = std::max(draw_quality.part_lod, 1.5f);
+		draw_quality.food_size_min = std::max<coordinate_t>(draw_quality.food_size_min, 4);
+		draw_quality.minimap_period_us = std::max<uint64_t>(draw_quality.minimap_period_us, 2000000);
+		draw_quality.names = false;
+		draw_quality.render_scale = std::min(draw_quality.render_scale, render_scale_min);
+	}
+	draw_quality.render_scale = std::min(std::max(draw_quality.render_scale, render_scale_min), 1.f);
+}
+
+// the draw zone closes before the watchdog takes the frame's zone times
 void game_t::draw()
+{
+	const uint64_t draw_us = draw_frame();
+	watchdog.frame_end(uptime_us(), draw_us, screen.texture_cnt);
+}
+
+uint64_t game_t::draw_frame()
 {
 	static uint64_t draw_tstamp = 0;
+	static uint64_t draw_work_us = 0;
 	uint64_t now_us = uptime_us();
+	frame_now_us = now_us;
 	size_t delta_us = now_us - draw_tstamp;
 	draw_tstamp = now_us;
-
-	if (draw_ctx_update() || my_snake_dead())
+	if (profile_tick(now_us))
+		pkt_stat_snapshot();
+	if (screen.key_pressed('p'))
+		profile_overlay = !profile_overlay;
+	if (screen.key_pressed('r'))
+		watchdog.dump(stderr);
+	PROFILE_ZONE("draw");
+
+	frame_arena.reset();
+	draw_stat = {};
+	if (quality_governor.update(draw_work_us))
+	{
+		LOG_INFO("quality level:%zu draw_us_avg:%.0f", quality_governor.level, quality_governor.draw_us_avg);
+		draw_quality_apply();
+	}
+	screen.scene_begin(draw_quality.render_scale);
+	if (draw_ctx_update(now_us) || my_snake_dead())
 		screen.clear();
+	const uint64_t network_delay = ping_ctx.extrapolate_us();
+	draw_extrapolate(now_us + network_delay);
+	draw_prepare(now_us + network_delay);
+	// screen calls only from here on, overlapping with the prepare jobs
 	draw_background();
+	{
+		PROFILE_ZONE("draw_wait");
+		job_system.wait();
+	}
+	for (size_t idx = 0; idx < snake_draw_list_count; ++idx)
+		draw_list_submit(draw_list_pool[idx]);
+	draw_prey();
+	for (size_t idx = 0; idx < food_draw_list_count; ++idx)
+		draw_list_submit(draw_list_pool[snake_draw_list_count + idx]);
+	food_list_trim();
+	screen.scene_end();
+
+	// text and HUD at window resolution
+	for (size_t idx = 0; idx < snake_draw_list_count; ++idx)
+		draw_list_text_submit(draw_list_pool[idx]);
 	draw_leaderboard();
-	int32_t network_delay = ping_ctx.ping_pong_avg_us / 2;
-	draw_snake_list(now_us + network_delay);
-	draw_prey(now_us + network_delay);
-	draw_food();
 	draw_minimap();
 
-	char buf[32];
+	char buf[96];
 	snprintf(buf, sizeof(buf), "%6lu", run_time_us() / 1000);
 	screen.text(20, 20, white, 15, buf);
 	fps = (fps + (1000000. / delta_us)) / 2;
-	snprintf(buf, sizeof(buf), "FPS:%6.2f", fps);
+	snprintf(buf, sizeof(buf), "FPS:%6.2f slow:%zu", fps, watchdog.slow_cnt);
 	screen.text(20, 40, white, 15, buf);
+	snprintf(buf, sizeof(buf), "snakes:%3zu culled:%3zu",
+		draw_stat.snake_drawn, draw_stat.snake_culled);
+	screen.text(20, 60, white, 15, buf);
+	snprintf(buf, sizeof(buf), "parts:%5zu skipped:%5zu",
+		draw_stat.part_drawn, draw_stat.part_skipped);
+	screen.text(20, 80, white, 15, buf);
+	snprintf(buf, sizeof(buf), "quality:%zu%s draw:%5.2fms res:%3.0f%%", quality_governor.level,
+		quality_governor.enabled ? "A" : "", quality_governor.draw_us_avg / 1000.,
+		draw_quality.render_scale * 100.);
+	screen.text(20, 100, white, 15, buf);
+	snprintf(buf, sizeof(buf), "rtt:%3.0f var:%3.0f jit:%3.0f p99:%3u lost:%zu send:%3.0f jit:%3.0f ms",
+		ping_ctx.rtt.srtt_us / 1000., ping_ctx.rtt.rttvar_us / 1000., ping_ctx.rtt.jitter_us / 1000.,
+		ping_ctx.rtt.percentile_us(0.99) / 1000, ping_ctx.lost_cnt,
+		send_spacing.send_us_avg / 1000., send_spacing.arrival_jitter_us / 1000.);
+	screen.text(20, 120, white, 15, buf);
+	if (profile_overlay)
+		draw_profile();
 
-	screen.present();
+	{
+		PROFILE_ZONE("present");
+		screen.present();
+	}
+	draw_work_us = uptime_us() - now_us;
 	have_data = false;
+	return draw_work_us;
 }
 
 size_t snake_body_part_radius(size_t parts_count, float scale)
@@ -915,6 +1161,15 @@ size_t snake_body_part_radius(size_t parts_count, float scale)
 	return static_cast<size_t>(sbpr);
 }
 
+// game832434.js: gsc = .64285 + .514285714 / Math.max(1, (sct + 16) / 36)
+// relative to the gsc of a new snake
+float view_scale(size_t parts_count)
+{
+	static const float gsc_max = 0.64285f + 0.514285714f;
+	const float gsc = 0.64285f + 0.514285714f / std::max(1.f, (parts_count + 16) / 36.f);
+	return view_scale_base * gsc / gsc_max;
+}
+
 uint8_t rr_list[] = {192, 144, 128, 128, 238, 255, 255, 255, 224, 255, 144, 80, 255, 40, 100, 120, 72, 160, 255, 56, 56, 78, 255, 101, 128, 60, 0, 217, 255, 144, 32, 240, 240, 240, 240, 32, 40, 104, 0, 104, /*0*/ 128};
 uint8_t gg_list[] = {128, 153, 208, 255, 238, 160, 144, 64, 48, 255, 153, 80, 192, 136, 117, 134, 84, 80, 224, 68, 68, 35, 86, 200, 132, 192, 255, 69, 64, 144, 32, 32, 240, 144, 32, 240, 60, 128, 0, 40, /*0*/ 208};
 uint8_t bb_list[] = {255, 255, 208, 128, 112, 96, 144, 64, 224, 255, 255, 80, 80, 96, 255, 255, 255, 255, 64, 255, 255, 192, 9, 232, 144, 72, 83, 69, 64, 144, 240, 32, 32, 32, 240, 32, 173, 255, 112, 170, /*0*/ 208};
@@ -922,49 +1177,119 @@ uint8_t bb_list[] = {255, 255, 208, 128, 112, 96, 144, 64, 224, 255, 255, 80, 80
 static const size_t max_skin_cv = sizeof(rr_list) / sizeof(*rr_list);
 // TODO make skin->color map like in game832434.js:setSkin()
 
-void game_t::draw_part(xy_t xy, size_t radius, size_t snake_id)
+// body line corners shorter than this are not smoothed, pixels
+static const coordinate_t body_smooth_distance_min = 4;
+static const size_t body_bezier_seg = 4;
+
+void game_t::body_prepare(draw_list_t& list, size_t radius, const snake_t& snake)
 {
-	size_t color_idx = snake_get(snake_id).skin;
+	size_t color_idx = snake.skin;
 	if (color_idx >= max_skin_cv)
 		color_idx = color_idx % max_skin_cv;
 	color_t color{rr_list[color_idx], gg_list[color_idx], bb_list[color_idx]};
 
-	screen.octagon(xy.x, xy.y, radius, color);
+	// round the corners with a quadratic bezier
+	// from the middle of one segment to the middle of the next one
+	const std::vector<xy_t>& body_line = list.body_line;
+	const size_t first = list.xy_list.size();
+	list.xy_list.push_back(body_line.front());
+	for (size_t idx = 1; idx + 1 < body_line.size(); ++idx)
+	{
+		const xy_t p1 = xy_mid(body_line[idx - 1], body_line[idx]);
+		const xy_t p3 = xy_mid(body_line[idx], body_line[idx + 1]);
+		if (distance(p1, p3) < body_smooth_distance_min)
+		{
+			list.xy_list.push_back(body_line[idx]);
+			continue;
+		}
+		const xy_t* curve = make_quad_bezier<body_bezier_seg>(list.arena, p1, body_line[idx], p3);
+		list.xy_list.insert(list.xy_list.end(), curve, curve + body_bezier_seg + 1);
+	}
+	if (body_line.size() > 1)
+		list.xy_list.push_back(body_line.back());
+
+	list.ribbon_list.push_back(draw_list_t::ribbon_t{first, list.xy_list.size() - first,
+		static_cast<float>(radius), color});
+	// round head and tail, a body zoomed out to a single point is only these
+	list.octagon_list.push_back(draw_list_t::shape_t{body_line.front(), static_cast<coordinate_t>(radius), color});
+	if (body_line.size() > 1)
+		list.octagon_list.push_back(draw_list_t::shape_t{body_line.back(), static_cast<coordinate_t>(radius), color});
 }
 
-void game_t::draw_snake(size_t snake_id, uint64_t now_us)
+// runs on a job thread, touches only this snake and list
+void game_t::snake_prepare(draw_list_t& list, snake_t& snake, uint64_t now_us)
 {
-	draw_snake_prepare1(snake_id, now_us);
-	snake_t& snake = snake_get(snake_id);
-
-	const rect_t screen_rect{xy_t{0, 0}, xy_t{screen.width, screen.height}};
+	PROFILE_ZONE("snake_prepare");
 	assert(draw_ctx.scale > 0.);
-	size_t radius = snake_body_part_radius(snake.snake_length, draw_ctx.scale);
+	// keep the body visible when zoomed out to the whole game field
+	size_t radius = std::max<size_t>(snake_body_part_radius(snake.snake_length, draw_ctx.scale), 1);
 	snake.tstamp_draw = now_us;
+	list.stat.snake_drawn++;
 	size_t length = std::min(snake.snake_length, snake.part_list.size());
-	draw_part(screen_xy(snake.head), radius, snake_id);
+	coordinate_t lod_distance = draw_quality.part_lod * radius;
+	if (draw_quality.part_lod > 0.)
+		lod_distance = std::max<coordinate_t>(lod_distance, 1);
+	const coordinate_t lod_distance2 = lod_distance * lod_distance;
+	std::vector<xy_t>& xy_game_buf = list.xy_game_buf;
+	std::vector<xy_t>& xy_screen_buf = list.xy_screen_buf;
+	std::vector<xy_t>& body_line = list.body_line;
+	xy_game_buf.clear();
+	xy_game_buf.push_back(snake.head);
 	for (size_t idx = 0; idx < length; ++idx)
+		xy_game_buf.push_back(xy_int(snake.part_list[idx]));
+	xy_screen_buf.resize(xy_game_buf.size());
+	xy_transform(screen_transform(), xy_game_buf.data(), xy_game_buf.size(), xy_screen_buf.data());
+	body_line.clear();
+	body_line.push_back(xy_screen_buf[0]);
+	for (size_t idx = 1; idx < xy_screen_buf.size(); ++idx)
 	{
-		xy_t xy = screen_xy(snake.part_list[idx]);
-		if (!screen_rect.has(xy))
+		const xy_t& xy = xy_screen_buf[idx];
+		const coordinate_t dx = xy.x - body_line.back().x;
+		const coordinate_t dy = xy.y - body_line.back().y;
+		if (dx * dx + dy * dy < lod_distance2)
+		{
+			list.stat.part_skipped++;
 			continue;
-		draw_part(xy, radius, snake_id);
+		}
+		body_line.push_back(xy);
+		list.stat.part_drawn++;
 	}
+	body_prepare(list, radius, snake);
 	if (snake.part_list.size() < 2)
 	{
 		return;
 	}
 
-	xy_t xy = screen_xy(snake_get(snake_id).head);
-	if (strlen(snake.name) > 0)
-		screen.text(xy.x, xy.y, white, 15, snake.name);
+	if (draw_quality.names && strlen(snake.name) > 0)
+		list.text_list.push_back(draw_list_t::text_t{xy_screen_buf[0], snake.name});
+}
+
+void game_t::draw_list_text_submit(const draw_list_t& list)
+{
+	PROFILE_ZONE("draw_list_text_submit");
+	for (const draw_list_t::text_t& text : list.text_list)
+		screen.text(text.xy.x, text.xy.y, white, 15, text.text);
+}
+
+void game_t::draw_list_submit(const draw_list_t& list)
+{
+	PROFILE_ZONE("draw_list_submit");
+	for (const draw_list_t::ribbon_t& ribbon : list.ribbon_list)
+		screen.ribbon(list.xy_list.data() + ribbon.first, ribbon.count, ribbon.radius, ribbon.color);
+	for (const draw_list_t::shape_t& shape : list.octagon_list)
+		screen.octagon(shape.xy.x, shape.xy.y, shape.radius, shape.color);
+	for (const draw_list_t::shape_t& shape : list.octastar_list)
+		screen.octastar(shape.xy.x, shape.xy.y, shape.radius, shape.color);
+	draw_stat.snake_drawn += list.stat.snake_drawn;
+	draw_stat.part_drawn += list.stat.part_drawn;
+	draw_stat.part_skipped += list.stat.part_skipped;
 }
 
 float snake_heading(const snake_t& snake)
 {
  	if (snake.part_list.size() < 2)
 		return invalid_angle;
-	return xy_angle(snake.part_list[1], snake.part_list[0]);
+	return xy_angle(xy_int(snake.part_list[1]), xy_int(snake.part_list[0]));
 }
 
 rot_dir_t rot_dir_calc(float from, float to)
@@ -978,7 +1303,7 @@ rot_dir_t rot_dir_calc(float from, float to)
 	return rot_dir_cw;
 }
 
-void game_t::draw_snake_prepare1(size_t snake_id, uint64_t now_us)
+void game_t::snake_kinematics_add(size_t snake_id)
 {
 	static const float angle_tolerance = (2 * M_PI) / (250 + 1);  // TODO 250 - part of the protocol
 	snake_t& snake = snake_get(snake_id);
@@ -986,80 +1311,143 @@ void game_t::draw_snake_prepare1(size_t snake_id, uint64_t now_us)
 		return;
 	if (snake.part_list.empty())
 		return;
-	float heading = snake_heading(snake);
 	float rot_angle = norm_angle(snake.rot_angle);
 	if (::abs(snake.rot_angle - invalid_angle) < angle_tolerance)
-		rot_angle = heading;
-	size_t delta_us = now_us - snake.tstamp_data;
+		rot_angle = snake_heading(snake);
 	coordinate_t speed_step_ps = snake.speed;
 	static const float speed_ko = 0.6;
 	float speed = speed_step_ps * snake_step_distance * speed_ko;
 	if (::abs(snake.speed - invalid_angle) < angle_tolerance)
 		speed = snake_speed * snake_step_distance;
+	kinematics.add(xy_int(snake.part_list[0]), rot_angle, 0., speed, snake.tstamp_data);
+	kinematics_snake_list.push_back(snake_id);
+}
 
-	coordinate_t delta_distance = speed * delta_us / 1000000;
-	if (delta_distance == 0)
-	{
-		snake.head = snake.part_list[0];
-		return;
-	}
-	if (snake_id == my_snake_id)
+// extrapolate prey and snake heads from the last received state in one pass
+void game_t::draw_extrapolate(uint64_t now_us)
+{
+	PROFILE_ZONE("draw_extrapolate");
+	kinematics.clear();
+	kinematics_snake_list.clear();
+	for (const prey_t& prey : prey_list)
 	{
-		LOG("delta_us:%zu delta_distance:%d snake.speed:%f speed:%f",
-			delta_us, delta_distance, snake.speed, speed);
+		float speed = 1000. * prey.speed / 8. / 4.;
+		if (speed > 200.)
+			speed = 200.;
+		// manu2 angle in rad per 8ms at which prey can turn) 0.028 0.028, turn_rate in rad per us
+		float turn_rate = config.manu2 / 1000. / 8. * 0.4;
+		float angle = norm_angle(prey.rot_angle);
+		switch(prey.dir)
+		{
+			case rot_dir_no: angle = norm_angle(prey.rot_wangle); turn_rate = 0.; break;
+			case rot_dir_ccw: turn_rate = -turn_rate; break;
+			case rot_dir_cw: break;
+			default: turn_rate = 0.; break;
+		}
+		kinematics.add(prey.xy, angle, turn_rate, speed, prey.tstamp_data);
 	}
-	xy_t xy_ext{snake.part_list[0]};
-	xy_ext.x += ::cosf(rot_angle) * delta_distance;
-	xy_ext.y += ::sinf(rot_angle) * delta_distance;
-
-	snake.head = xy_ext;
 
-#ifdef DEBUG_LOG
-	if (delta_us < draw_period_us)
+	if (!my_snake_dead())
+		snake_kinematics_add(my_snake_id);
+	for (size_t snake_id : snake_id_list)
 	{
 		if (snake_id == my_snake_id)
-		{
-			float dist_error = 0.;
-			coordinate_t dist_p0 = distance(snake.prev, snake.part_list[0]);
-			coordinate_t dist_ph = distance(snake.prev, snake.head);
-			dist_error = dist_p0 - dist_ph;
-			LOG("delta_us:%zu dist_error:%f dist_p0:%d dist_ph:%d",
-				delta_us, dist_error, dist_p0, dist_ph);
-		}
+			continue;
+		snake_kinematics_add(snake_id);
 	}
-#endif  // DEBUG_LOG
+
+	kinematics.extrapolate(now_us);
+
+	const size_t snake_first = prey_list.size();
+	for (size_t idx = 0; idx < kinematics_snake_list.size(); ++idx)
+		snake_get(kinematics_snake_list[idx]).head = kinematics.xy_out[snake_first + idx];
 }
 
-void game_t::draw_snake_list(uint64_t now_us)
+bool game_t::snake_visible(const snake_t& snake)
 {
-	if (!my_snake_dead())
-		draw_snake(my_snake_id, now_us);
+	if (snake.part_list.empty())
+		return false;
+	rect_t bbox = snake.bbox;
+	bbox.expand(snake.head);
+	const coordinate_t margin = snake_body_part_radius(snake.snake_length, 1.) + 1;
+	bbox.ul.x -= margin;
+	bbox.ul.y -= margin;
+	bbox.lr.x += margin;
+	bbox.lr.y += margin;
+	return bbox.intersects(draw_ctx.screen_rect);
+}
 
+// cull on this thread, push one job per visible snake and per food_job_size food
+void game_t::draw_prepare(uint64_t now_us)
+{
+	PROFILE_ZONE("draw_prepare");
+	snake_draw_list = frame_arena.alloc_array<snake_t*>(snake_id_list.size() + 1);
+	snake_draw_list_count = 0;
+	if (!my_snake_dead())
+		snake_draw_list[snake_draw_list_count++] = &snake_get(my_snake_id);
 	for (size_t snake_id : snake_id_list)
 	{
 		if (snake_id == my_snake_id)
 			continue;
-		draw_snake(snake_id, now_us);
+		snake_t& snake = snake_get(snake_id);
+		if (!snake_visible(snake))
+		{
+			draw_stat.snake_culled++;
+			continue;
+		}
+		snake_draw_list[snake_draw_list_count++] = &snake;
 	}
+	prepare_now_us = now_us;
+	food_draw_list_count = (food_list.size() + food_job_size - 1) / food_job_size;
+	if (draw_list_pool.size() < snake_draw_list_count + food_draw_list_count)
+		draw_list_pool.resize(snake_draw_list_count + food_draw_list_count);
+
+	// jobs capture no more than std::function keeps without a heap allocation
+	for (size_t idx = 0; idx < snake_draw_list_count; ++idx)
+		job_system.push([this, idx]()
+			{
+				draw_list_t& list = draw_list_pool[idx];
+				list.clear();
+				snake_prepare(list, *snake_draw_list[idx], prepare_now_us);
+			});
+	for (size_t idx = 0; idx < food_draw_list_count; ++idx)
+		job_system.push([this, idx]()
+			{
+				draw_list_t& list = draw_list_pool[snake_draw_list_count + idx];
+				const size_t first = idx * food_job_size;
+				list.clear();
+				food_prepare(list, first, std::min(food_job_size, food_list.size() - first));
+			});
 }
 
-void game_t::draw_food()
+// runs on a job thread, food_list must not change until the jobs are done
+void game_t::food_prepare(draw_list_t& list, size_t first, size_t count)
 {
+	PROFILE_ZONE("food_prepare");
 	const rect_t screen_rect{xy_t{0, 0}, xy_t{screen.width, screen.height}};
-	for (food_t xy : food_list)
+	list.xy_game_buf.clear();
+	for (size_t idx = first; idx < first + count; ++idx)
+		list.xy_game_buf.push_back(xy_t{food_list[idx].x, food_list[idx].y});
+	list.xy_screen_buf.resize(count);
+	list.xy_idx_buf.resize(count);
+	const size_t visible_cnt = xy_transform_cull(screen_transform(), screen_rect,
+		list.xy_game_buf.data(), count, list.xy_screen_buf.data(), list.xy_idx_buf.data());
+	for (size_t idx = 0; idx < visible_cnt; ++idx)
 	{
-		xy_t xy_scr = screen_xy(xy);
-		if (xy.eaten)
-			continue;
-		if (!screen_rect.has(xy_scr))
+		const food_t& xy = food_list[first + list.xy_idx_buf[idx]];
+		if (xy.eaten || xy.size < draw_quality.food_size_min)
 			continue;
 		size_t color_idx = xy.color;
 		if (color_idx >= max_skin_cv)
 			color_idx = color_idx % max_skin_cv;
 		color_t color{rr_list[color_idx], gg_list[color_idx], bb_list[color_idx]};
-		screen.octastar(xy_scr.x, xy_scr.y, xy.size * draw_ctx.scale, color);
+		list.octastar_list.push_back(draw_list_t::shape_t{list.xy_screen_buf[idx],
+			static_cast<coordinate_t>(xy.size * draw_ctx.scale), color});
 	}
+}
 
+void game_t::food_list_trim()
+{
 	food_list.erase(
 		std::remove_if(food_list.begin(), food_list.end(),
 		[](const food_t& food){ return food.eaten == true; }), food_list.end());
@@ -1069,37 +1457,21 @@ void game_t::draw_food()
 		[this](const food_t& food){ return !draw_ctx.game_view_rect.has(food); }), food_list.end());
 }
 
-void game_t::draw_prey(uint64_t now_us)
+void game_t::draw_prey()
 {
+	PROFILE_ZONE("draw_prey");
 	const rect_t screen_rect{xy_t{0, 0}, xy_t{screen.width, screen.height}};
-	for (prey_t prey : prey_list)
+	const size_t prey_cnt = prey_list.size();
+	xy_screen_buf.resize(prey_cnt);
+	xy_idx_buf.resize(prey_cnt);
+	const size_t visible_cnt = xy_transform_cull(screen_transform(), screen_rect,
+		kinematics.xy_out.data(), prey_cnt, xy_screen_buf.data(), xy_idx_buf.data());
+	for (size_t idx = 0; idx < visible_cnt; ++idx)
 	{
-		size_t delta_us = now_us - prey.tstamp_data;
-		float speed = 1000. * prey.speed / 8. / 4.;
-		if (speed > 200.)
-			speed = 200.;
-		coordinate_t dist = speed * delta_us / 1000000.;
-
-		xy_t xy_ext{prey.xy};
-		// manu2 angle in rad per 8ms at which prey can turn) 0.028 0.028
-		float delta_angle = config.manu2  * delta_us / 1000. / 8. * 0.4;
-		float angle = norm_angle(prey.rot_angle);
-		switch(prey.dir)
-		{
-			case rot_dir_no: angle = norm_angle(prey.rot_wangle); break;
-			case rot_dir_ccw: angle -= delta_angle; break;
-			case rot_dir_cw: angle += delta_angle; break;
-			default: break;
-		}
-		angle = norm_angle(angle);
-		xy_ext.x += ::cosf(angle) * dist;
-		xy_ext.y += ::sinf(angle) * dist;
-
-		xy_t xy_scr = screen_xy(xy_ext);
+		const prey_t& prey = prey_list[xy_idx_buf[idx]];
+		const xy_t& xy_scr = xy_screen_buf[idx];
 		if (prey.eaten)
 			continue;
-		if (!screen_rect.has(xy_scr))
-			continue;
 		size_t color_idx = prey.color;
 		if (color_idx >= max_skin_cv)
 			color_idx = color_idx % max_skin_cv;
@@ -1116,24 +1488,20 @@ void game_t::draw_prey(uint64_t now_us)
 
 void game_t::draw_minimap()
 {
+	PROFILE_ZONE("draw_minimap");
 	const float scale = 4.;
 	const xy_t map_pos{screen.width - (80 * scale), screen.height - (80 * scale)};
 	rect_t map_rect{map_pos, xy_t{map_pos.x + (80 * scale), map_pos.y + (80 * scale)}};
 	xy_t map_ctr = map_rect.center();
 
-	for (size_t idx = 0; idx < minimap.size(); idx++)
+	const uint64_t now_us = frame_now_us;
+	if (minimap_updated && now_us - minimap_tstamp >= draw_quality.minimap_period_us)
 	{
-		if (!minimap[idx])
-			continue;
-		xy_t xy{idx % 80, idx / 80};
-		xy.x = (xy.x * scale) + map_pos.x;
-		xy.y = (xy.y * scale) + map_pos.y;
-		screen.point(
-			xy.x,
-			xy.y,
-			white
-		);
+		screen.bitmap_update(minimap.word_list.data(), minimap.width, minimap.height);
+		minimap_updated = false;
+		minimap_tstamp = now_us;
 	}
+	screen.bitmap(map_pos.x, map_pos.y, scale, white);
 	screen.circle(map_ctr.x, map_ctr.y, map_rect.width() / 2, white);
 
 	const float game_scale = 80. / (config.game_radius * 2);
@@ -1143,8 +1511,53 @@ void game_t::draw_minimap()
 	screen.octagon(xy.x, xy.y, 4, red);
 }
 
+// p50 p99 max per zone over the last second, toggled with p
+void game_t::draw_profile()
+{
+	const std::vector<const profile_zone_t*> zone_list = profile_zone_list();
+	coordinate_t y = 140;
+	screen.text(20, y, white, 15, "zone                 p50     p99     max us   count  alloc/call");
+	for (const profile_zone_t* zone : zone_list)
+	{
+		char buf[96];
+		const profile_stat_t& stat = zone->stat;
+		snprintf(buf, sizeof(buf), "%-18s %7.1f %7.1f %7.1f %7lu %7.1f", zone->name,
+			stat.p50_ns / 1000., stat.p99_ns / 1000., stat.max_ns / 1000., stat.count,
+			1. * stat.alloc_cnt / std::max<uint64_t>(stat.count, 1));
+		y += 20;
+		screen.text(20, y, white, 15, buf);
+	}
+
+	// packet types by decode time in the last second
+	arena_vector_t<uint8_t> type_list{arena_allocator_t<uint8_t>(frame_arena)};
+	type_list.reserve(pkt_type_count);
+	for (size_t type = 0; type < pkt_type_count; ++type)
+		if (pkt_stat_last.type_list[type].count != pkt_stat_prev.type_list[type].count)
+			type_list.push_back(type);
+	auto decode_ns = [this](uint8_t type)
+		{
+			return pkt_stat_last.type_list[type].decode_ns - pkt_stat_prev.type_list[type].decode_ns;
+		};
+	std::sort(type_list.begin(), type_list.end(),
+		[&decode_ns](uint8_t a, uint8_t b){ return decode_ns(a) > decode_ns(b); });
+	y += 30;
+	screen.text(20, y, white, 15, "pkt      count/s    KB/s  reject   decode us/s  alloc/pkt");
+	for (size_t idx = 0; idx < std::min<size_t>(type_list.size(), 8); ++idx)
+	{
+		const pkt_type_stat_t& last = pkt_stat_last.type_list[type_list[idx]];
+		const pkt_type_stat_t& prev = pkt_stat_prev.type_list[type_list[idx]];
+		char buf[96];
+		snprintf(buf, sizeof(buf), "%-8s %7lu %7.1f %7lu %9.1f %10.1f", pkt_trace_name(type_list[idx]) + 4,
+			last.count - prev.count, (last.bytes - prev.bytes) / 1024., last.reject - prev.reject,
+			decode_ns(type_list[idx]) / 1000., 1. * (last.alloc_cnt - prev.alloc_cnt) / (last.count - prev.count));
+		y += 20;
+		screen.text(20, y, white, 15, buf);
+	}
+}
+
 void game_t::draw_leaderboard()
 {
+	PROFILE_ZONE("draw_leaderboard");
 	if (!leaderboard.have_data)
 		return;
 	char buf[80];
@@ -1173,23 +1586,61 @@ void game_t::draw_leaderboard()
 
 void game_t::draw_background()
 {
+	PROFILE_ZONE("draw_background");
 	xy_t& ul = draw_ctx.game_view_rect.ul;
 	xy_t& ctr = draw_ctx.game_view_center;
 	xy_t game_ctr{config.game_radius, config.game_radius};
 	const coordinate_t view_radius = distance(ctr, ul);
 	if (distance(ctr, game_ctr) < config.game_radius - view_radius)
 		return;
-	for (size_t idx = 0; idx < edge_points.size() - 1; ++idx)
+
+	const std::vector<xy_t>& edge_points = edge_lod_list[edge_lod_get(draw_ctx.scale)];
+	const size_t point_cnt = edge_points.size();
+	const rect_t& rect = draw_ctx.screen_rect;
+	size_t idx_first = 0;
+	size_t idx_last = point_cnt;
+	if (!rect.has(game_ctr))
 	{
-		xy_t xy1 = screen_xy(edge_points[idx]);
-		xy_t xy2 = screen_xy(edge_points[idx + 1]);
-		screen.line(xy1.x, xy1.y, xy2.x, xy2.y, red);
+		// the edge can be visible only inside the angle the screen is seen at from the game center
+		const float ang_ctr = ::atan2f(ctr.y - game_ctr.y, ctr.x - game_ctr.x);
+		const xy_t corner_list[] = {rect.ul, xy_t{rect.lr.x, rect.ul.y}, rect.lr, xy_t{rect.ul.x, rect.lr.y}};
+		float ang_min = 0.;
+		float ang_max = 0.;
+		for (const xy_t& corner : corner_list)
+		{
+			float ang = ::atan2f(corner.y - game_ctr.y, corner.x - game_ctr.x) - ang_ctr;
+			if (ang > M_PI)
+				ang -= M_PI * 2;
+			if (ang < -M_PI)
+				ang += M_PI * 2;
+			ang_min = std::min(ang_min, ang);
+			ang_max = std::max(ang_max, ang);
+		}
+		const float ang_stp = M_PI * 2 / point_cnt;
+		const float ang_first = norm_angle(ang_ctr + ang_min);
+		idx_first = static_cast<size_t>(ang_first / ang_stp) % point_cnt;
+		idx_last = idx_first + static_cast<size_t>((ang_max - ang_min) / ang_stp) + 2;
 	}
-	xy_t xy1 = screen_xy(edge_points[0]);
-	xy_t xy2 = screen_xy(edge_points[edge_points.size() - 1]);
-	screen.line(xy1.x, xy1.y, xy2.x, xy2.y, red);
 
-	return;
+	edge_arc.clear();
+	for (size_t idx = idx_first; idx <= idx_last; ++idx)
+		edge_arc.push_back(edge_points[idx % point_cnt]);
+	xy_transform(screen_transform(), edge_arc.data(), edge_arc.size(), edge_arc.data());
+	screen.lines(edge_arc.data(), edge_arc.size(), red);
+}
+
+// the least tessellation level which deviates from the true circle by less than half a pixel
+size_t game_t::edge_lod_get(float scale)
+{
+	const float radius = (config.game_radius - config.sector_size) * scale;
+	size_t lod = 0;
+	for (; lod < edge_lod_count - 1; ++lod)
+	{
+		const float sagitta = radius * (1. - ::cosf(M_PI / edge_lod_list[lod].size()));
+		if (sagitta < 0.5)
+			break;
+	}
+	return lod;
 }
 
 void game_t::edge_points_calc()
@@ -1197,14 +1648,19 @@ void game_t::edge_points_calc()
 	// TODO I am killed when not over config.game_radius. Sectors? Not enogh.
 	coordinate_t game_radius = config.game_radius - config.sector_size;
 	xy_t game_ctr{config.game_radius, config.game_radius};
-	float ang_stp_div = edge_points.size();  // 360
-	float ang_stp  = M_PI * 2 / ang_stp_div;
-	for (int32_t cnt = 0; cnt < M_PI * 2 / ang_stp; ++cnt)
+	for (size_t lod = 0; lod < edge_lod_count; ++lod)
 	{
-		edge_points[cnt] = game_ctr;
-		edge_points[cnt].x += ::cosf(norm_angle(ang_stp * cnt)) * game_radius;
-		edge_points[cnt].y += ::sinf(norm_angle(ang_stp * cnt)) * game_radius;
+		std::vector<xy_t>& edge_points = edge_lod_list[lod];
+		edge_points.resize(edge_lod_point_count_min << lod);
+		float ang_stp = M_PI * 2 / edge_points.size();
+		for (size_t cnt = 0; cnt < edge_points.size(); ++cnt)
+		{
+			edge_points[cnt] = game_ctr;
+			edge_points[cnt].x += ::cosf(ang_stp * cnt) * game_radius;
+			edge_points[cnt].y += ::sinf(ang_stp * cnt) * game_radius;
+		}
 	}
+	edge_arc.reserve(edge_lod_list[edge_lod_count - 1].size() + 1);
 }
 
 float game_t::mouse_angle()
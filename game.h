@@ -1,6 +1,7 @@
 #ifndef GAME_H
 #define GAME_H
 
+#include <array>
 #include <vector>
 #include <deque>
 #include <mutex>
@@ -11,12 +12,19 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 #include <sys/types.h>
 
+#include "arena.h"
 #include "geometry.h"
+#include "geometry_batch.h"
+#include "bitmap.h"
+#include "kinematics.h"
+#include "job_system.h"
 #include "clock.h"
 #include "log.h"
-#include "screen_sdl.h"
+#include "screen.h"
+#include "watchdog.h"
 
 static const coordinate_t game_radius = 21600;
 static const coordinate_t sector_size = 300;
@@ -29,6 +37,15 @@ static const size_t draw_fps = 60;
 static const size_t draw_period_us = 1000000 / draw_fps;
 static const size_t mouse_period_us = 300000;//250000;
 static const size_t ping_period_us = 250000;
+static const size_t pong_timeout_us = 2000000;  // count the ping lost and send the next one
+static const size_t extrapolate_max_us = 200000;
+static const size_t edge_lod_count = 5;  // 64, 128, 256, 512, 1024 points per arena edge
+static const size_t edge_lod_point_count_min = 64;
+static const float view_scale_base = 0.5;  // scale for a new snake, zooms out as it grows
+static const float zoom_min = 0.25;
+static const float zoom_max = 4.;
+static const float zoom_step = 1.1;  // per mouse wheel step
+static const float scale_time_us = 250000.;  // time constant of the scale smoothing
 
 struct food_t
 {
@@ -73,6 +90,11 @@ struct prey_t
 
 static const float invalid_angle = -1.;
 
+// snake body coordinates, fixed_t keeps the sub-unit part of squeeze() between moves
+// coordinate_t here gives the old whole unit behaviour
+typedef fixed_t<12> part_coordinate_t;
+typedef basic_xy_t<part_coordinate_t> part_xy_t;
+
 struct snake_t
 {
 	size_t snake_length;
@@ -81,7 +103,8 @@ struct snake_t
 	rot_dir_t rot_dir;
 	bool dead;
 	uint8_t skin;
-	std::deque<xy_t> part_list;
+	std::deque<part_xy_t> part_list;
+	rect_t bbox;  // bounds all of part_list in whole units
 	xy_t head;
 	xy_t prev;
 	float rot_angle;
@@ -101,31 +124,40 @@ struct snake_t
 		memset(name, 0, sizeof(name));
 	}
 
-	void move(const xy_t& xy)
+	void move(const xy_t& xy, uint64_t now_us)
 	{
-		uint64_t now_us = uptime_us();
-		prev = part_list.front();
-		part_list.emplace_front(xy);
-		LOG("dist:%d %jd", distance(xy, part_list[0]), now_us - tstamp_data);
+		prev = xy_int(part_list.front());
+		part_list.push_front(part_xy_t{xy.x, xy.y});
+		if (part_list.size() == 1)
+			bbox = {xy, xy};
+		else
+			bbox.expand(xy);
+		LOG("dist:%d %jd", distance(xy, prev), now_us - tstamp_data);
 		tstamp_data = now_us;
 		squeeze();
 		part_list_trim();
 	}
 
+	void bbox_calc()
+	{
+		if (part_list.empty())
+		{
+			bbox = {};
+			return;
+		}
+		bbox = {xy_int(part_list.front()), xy_int(part_list.front())};
+		for (const part_xy_t& part : part_list)
+			bbox.expand(xy_int(part));
+	}
+
+	// parts only move towards their neighbours, so bbox stays valid
 	void squeeze()
 	{
 		// TODO take from game.config
 		static const float cst = 0.43;  // cst
 		if (part_list.size() < 4)
 			return;
-		float w = 0.;
-		for (size_t idx = 3; idx < part_list.size(); ++idx)
-		{
-			if (idx <= 4)
-				w = cst * idx / 4.;
-			part_list[idx].x += 1. * (part_list[idx - 1].x - part_list[idx].x) * w;
-			part_list[idx].y += 1. * (part_list[idx - 1].y - part_list[idx].y) * w;
-		}
+		xy_list_squeeze<part_coordinate_t>(part_list, 3, cst);
 	}
 
 	void part_list_trim()
@@ -133,12 +165,19 @@ struct snake_t
 		static const size_t save_part_count = 40;
 		if (part_list.size() <= snake_length + save_part_count)
 			return;
+		bool bbox_shrink = false;
 		for (size_t cnt = 0; cnt < part_list.size() - snake_length + save_part_count; ++cnt)
+		{
+			bbox_shrink |= bbox.on_border(xy_int(part_list.back()));
 			part_list.pop_back();
+		}
+		if (bbox_shrink)
+			bbox_calc();
 	}
 };
 
 float snake_heading(const snake_t& snake);
+float view_scale(size_t parts_count);
 
 struct leaderboard_player_t
 {
@@ -210,24 +249,297 @@ struct draw_ctx_t
 	coordinate_t height;
 	xy_t game_view_center;
 	rect_t game_view_rect;
+	rect_t screen_rect;  // visible part of the game field in game coordinates
 	float scale;
+	float scale_target;  // from snake length and zoom, scale follows it smoothly
+	float zoom;  // mouse wheel factor on top of the length based scale
+	uint64_t scale_tstamp;
 
 	bool ready(){ return game_view_center != xy_t{0, 0}; }
 };
 
+struct draw_stat_t
+{
+	size_t snake_drawn;
+	size_t snake_culled;
+	size_t part_drawn;
+	size_t part_skipped;
+};
+
+// screen space primitives made by one prepare job, submitted in order on the draw thread
+struct draw_list_t
+{
+	struct ribbon_t
+	{
+		size_t first;  // in xy_list
+		size_t count;
+		float radius;
+		screen_t::color_t color;
+	};
+
+	struct shape_t
+	{
+		xy_t xy;
+		coordinate_t radius;
+		screen_t::color_t color;
+	};
+
+	struct text_t
+	{
+		xy_t xy;
+		const char* text;  // valid until the list is submitted
+	};
+
+	void clear()
+	{
+		xy_list.clear();
+		ribbon_list.clear();
+		octagon_list.clear();
+		octastar_list.clear();
+		text_list.clear();
+		stat = {};
+		arena.reset();
+	}
+
+	std::vector<xy_t> xy_list;
+	std::vector<ribbon_t> ribbon_list;
+	std::vector<shape_t> octagon_list;  // round ribbon ends, drawn after the ribbons
+	std::vector<shape_t> octastar_list;
+	std::vector<text_t> text_list;
+	draw_stat_t stat;
+	// job scratch, capacity is kept between frames
+	std::vector<xy_t> xy_game_buf;
+	std::vector<xy_t> xy_screen_buf;
+	std::vector<uint32_t> xy_idx_buf;
+	std::vector<xy_t> body_line;
+	frame_arena_t arena;  // reset by clear()
+};
+
+static const size_t food_job_size = 512;
+
+struct draw_quality_t
+{
+	// skip body part closer than part_lod * body part radius
+	// to the last drawn one on screen, 0 - draw all parts
+	float part_lod;
+	coordinate_t food_size_min;  // skip smaller food
+	uint64_t minimap_period_us;  // minimum time between minimap texture updates
+	bool names;
+	float render_scale;  // scene resolution relative to the window, 0.5 - 1
+};
+
+static const float part_lod_default = 0.25;
+static const float render_scale_min = 0.5;
+
+static const size_t quality_level_count = 4;
+static const float quality_budget_high = 0.8;  // of draw_period_us, lower quality above
+static const float quality_budget_low = 0.4;  // raise quality below
+static const size_t quality_down_frame_count = 15;  // frames at one level before lowering
+static const size_t quality_up_frame_count = 180;  // before raising
+
+// moves draw quality level (0 - best) to keep draw() time within draw_period_us
+// lowers fast and raises slow so it does not flip between two levels
+struct quality_governor_t
+{
+	// returns true when level changed
+	bool update(uint64_t draw_us)
+	{
+		draw_us_avg += (1. * draw_us - draw_us_avg) * 0.1;
+		frame_cnt++;
+		if (!enabled)
+			return false;
+		if (draw_us_avg > draw_period_us * quality_budget_high &&
+			level + 1 < quality_level_count && frame_cnt >= quality_down_frame_count)
+		{
+			level++;
+			frame_cnt = 0;
+			return true;
+		}
+		if (draw_us_avg < draw_period_us * quality_budget_low &&
+			level > 0 && frame_cnt >= quality_up_frame_count)
+		{
+			level--;
+			frame_cnt = 0;
+			return true;
+		}
+		return false;
+	}
+
+	bool enabled;
+	size_t level;
+	float draw_us_avg;
+	size_t frame_cnt;
+};
+
+static const uint32_t rtt_bucket_us = 5000;
+static const size_t rtt_bucket_count = 100;  // the last one holds everything above 495 ms
+
+// round trip times of ping/pong, smoothed as in RFC 6298 (srtt, rttvar)
+// and jitter as in RFC 3550 (mean difference of consecutive samples)
+struct rtt_stat_t
+{
+	void add(uint32_t rtt_us)
+	{
+		if (cnt == 0)
+		{
+			srtt_us = rtt_us;
+			rttvar_us = rtt_us / 2.;
+			min_us = rtt_us;
+			max_us = rtt_us;
+		}
+		else
+		{
+			rttvar_us += (std::fabs(srtt_us - rtt_us) - rttvar_us) / 4;
+			srtt_us += (rtt_us - srtt_us) / 8;
+			jitter_us += (std::fabs(1. * rtt_us - last_us) - jitter_us) / 16;
+			min_us = std::min(min_us, rtt_us);
+			max_us = std::max(max_us, rtt_us);
+		}
+		last_us = rtt_us;
+		hist[std::min<size_t>(rtt_us / rtt_bucket_us, rtt_bucket_count - 1)]++;
+		cnt++;
+	}
+
+	// upper bound of the bucket holding the p part of all samples, 0 - 1
+	uint32_t percentile_us(float p) const
+	{
+		const size_t target = std::max<size_t>(1, std::ceil(p * cnt));
+		size_t sum = 0;
+		for (size_t idx = 0; idx < rtt_bucket_count; ++idx)
+		{
+			sum += hist[idx];
+			if (sum >= target)
+				return std::min<uint32_t>((idx + 1) * rtt_bucket_us, max_us);
+		}
+		return max_us;
+	}
+
+	size_t cnt;
+	uint32_t last_us;
+	uint32_t min_us;
+	uint32_t max_us;
+	float srtt_us;
+	float rttvar_us;
+	float jitter_us;
+	std::array<uint32_t, rtt_bucket_count> hist;
+};
+
 struct ping_ctx_t
 {
+	bool ping_due(uint64_t now_us)
+	{
+		if (now_us - ping_tstamp < ping_period_us)
+			return false;
+		if (!wait_pong)
+			return true;
+		if (now_us - ping_tstamp < pong_timeout_us)
+			return false;
+		// a pong still on its way is then taken for the next ping
+		lost_cnt++;
+		return true;
+	}
+
+	void ping(uint64_t now_us)
+	{
+		ping_tstamp = now_us;
+		wait_pong = true;
+		ping_cnt++;
+	}
+
+	void pong(uint64_t now_us)
+	{
+		if (!wait_pong)
+			return;
+		wait_pong = false;
+		rtt.add(now_us - ping_tstamp);
+	}
+
+	// how far ahead of the last server data to draw: one way delay, srtt / 2
+	uint64_t extrapolate_us() const
+	{
+		if (rtt.cnt == 0)
+			return 0;
+		return std::min<uint64_t>(rtt.srtt_us / 2, extrapolate_max_us);
+	}
+
 	bool wait_pong;
 	uint64_t ping_tstamp;
-	int32_t ping_pong_us;
-	int32_t ping_pong_avg_us;
+	size_t ping_cnt;
+	size_t lost_cnt;
+	rtt_stat_t rtt;
+};
+
+// server send spacing from pkt_hdr_t::client_time, the ms since the server got
+// our last message. Its growth between two packets is the time between their sends,
+// compared with the time between their arrivals it gives the network jitter.
+struct send_spacing_t
+{
+	void add(uint16_t client_time_ms, uint64_t now_us)
+	{
+		// client_time restarts when the server got a message from us
+		if (arrival_tstamp != 0 && client_time_ms >= client_time_prev)
+		{
+			const float send_us = (client_time_ms - client_time_prev) * 1000.;
+			const float arrival_us = now_us - arrival_tstamp;
+			send_us_avg += (send_us - send_us_avg) / 16;
+			arrival_jitter_us += (std::fabs(arrival_us - send_us) - arrival_jitter_us) / 16;
+		}
+		client_time_prev = client_time_ms;
+		arrival_tstamp = now_us;
+	}
+
+	uint16_t client_time_prev;
+	uint64_t arrival_tstamp;
+	float send_us_avg;
+	float arrival_jitter_us;
+};
+
+static const size_t pkt_type_count = 256;
+
+struct pkt_type_stat_t
+{
+	uint64_t count;
+	uint64_t bytes;  // payload after pkt_hdr_t
+	uint64_t reject;  // no handler or wrong size
+	uint64_t decode_ns;
+	uint64_t alloc_cnt;  // with alloc_track_on
+	uint64_t alloc_bytes;
+};
+
+// cumulative, plain counters owned by the thread calling pkt_handle()
+struct pkt_stat_t
+{
+	pkt_type_stat_t type_list[pkt_type_count];
+	uint64_t short_cnt;  // shorter than pkt_hdr_t
+};
+
+// draw thread state for other threads, copied once per second with pkt_stat_snap
+struct game_snap_t
+{
+	profile_stat_t frame_stat;  // present to present over the last second
+	profile_stat_t draw_stat;
+	size_t frame_cnt;  // since start
+	size_t slow_cnt;
+	size_t queue_depth;
+	uint32_t rtt_p50_us;  // since start
+	uint32_t rtt_p99_us;
+	size_t ping_cnt;
+	size_t ping_lost_cnt;
+	size_t text_cache_cnt;
+	size_t texture_cnt;  // created since start
+	size_t snake_cnt;
+	size_t food_cnt;
+	size_t prey_cnt;
+	size_t sector_cnt;
 };
 
 typedef std::function<void (const char)> pkt_sender_t;
 
+typedef bitmap_t<80, 80> minimap_t;
+
 struct game_t
 {
-	game_t(screen_sdl_t& screen_);
+	game_t(screen_t& screen_);
 	~game_t();
 	struct config_t
 	{
@@ -246,7 +558,8 @@ struct game_t
 
 	typedef void (game_t::*pkt_handler_t)(const uint8_t* buf, size_t size);
 	void pkt_handle_init();
-	void pkt_handle(const uint8_t* buf, size_t size);
+	// rx_us - uptime_us() when the packet came off the socket
+	void pkt_handle(const uint8_t* buf, size_t size, uint64_t rx_us);
 	void pkt_send(pkt_sender_t sender);
 	void pkt_init(const uint8_t* buf, size_t size);  // = 'a',  // Initial setup
 	void pkt_snake_fam(const uint8_t* buf, size_t size);  //  = 'h',	 // Update snake last body part fullness (fam)
@@ -273,29 +586,40 @@ struct game_t
 //	void pkt_kill(const uint8_t* buf, size_t size);  //  = 'k',	  // Kill (unused in the game-code)
 //	void pkt_highscore(const uint8_t* buf, size_t size);  //  = 'm',		// Global highscore
 	void pkt_pong(const uint8_t* buf, size_t size);  //  = 'p',			 // Pong
+	void pkt_stat_snapshot();
 
 	// custom debug
 //	void pkt_reset(const uint8_t* buf, size_t size);  //  = '0',  // reset debug render buffer
 //	void pkt_draw(const uint8_t* buf, size_t size);  //  = '!',   // draw something
 
-	bool draw_ctx_update();
+	bool draw_ctx_update(uint64_t now_us);
 	void draw();
+	uint64_t draw_frame();  // returns the draw time in us
 	void draw_minimap();
 	void draw_leaderboard();
+	void draw_profile();
 	void draw_background();
-	void draw_food();
-	void draw_prey(uint64_t now_us);
-	void draw_snake_list(uint64_t now_us);
-	void draw_snake_prepare1(size_t snake_id, uint64_t now_us);
-	void draw_snake(size_t snake_id, uint64_t now_us);
-	void draw_part(xy_t xy, size_t radius, size_t snake_id);
+	void draw_prey();
+	void draw_extrapolate(uint64_t now_us);
+	void snake_kinematics_add(size_t snake_id);
+	void draw_prepare(uint64_t now_us);
+	void snake_prepare(draw_list_t& list, snake_t& snake, uint64_t now_us);
+	void body_prepare(draw_list_t& list, size_t radius, const snake_t& snake);
+	void food_prepare(draw_list_t& list, size_t first, size_t count);
+	void food_list_trim();
+	void draw_list_submit(const draw_list_t& list);
+	void draw_list_text_submit(const draw_list_t& list);
+	void draw_quality_apply();
+	bool snake_visible(const snake_t& snake);
 	template <typename Txy>
 	xy_t screen_xy(const Txy& game_xy);
+	xy_transform_t screen_transform();
 	template <typename Txy>
 	xy_t game_xy(const Txy& screen_xy);
 	float mouse_angle();
 	bool my_snake_dead();
 	void edge_points_calc();
+	size_t edge_lod_get(float scale);
 	bool ready(){ return my_snake_id != snake_id_invalid; }
 	snake_t& snake_get(size_t snake_id)
 	{
@@ -312,8 +636,16 @@ public:
 	static const size_t snake_id_invalid = std::numeric_limits<size_t>::max();
 
 	config_t config;
-	screen_sdl_t& screen;
+	screen_t& screen;
 	draw_ctx_t draw_ctx;
+	draw_stat_t draw_stat;
+	draw_quality_t draw_quality;
+	draw_quality_t draw_quality_base;  // level 0, set by options
+	quality_governor_t quality_governor;
+	uint64_t minimap_tstamp;
+	// one clock read per packet and per frame for what needs no finer time
+	uint64_t pkt_rx_us;  // arrival of the packet in pkt_handle()
+	uint64_t frame_now_us;  // start of draw_frame()
 	pkt_handler_t pkt_handler_list[std::numeric_limits<char>::max()];
 	bool have_data;
 	size_t my_snake_id;
@@ -322,11 +654,37 @@ public:
 	std::array<snake_t*, std::numeric_limits<uint16_t>::max()> snake_list;
 	std::deque<size_t> snake_id_list;
 	std::deque<prey_t> prey_list;
-	std::array<uint8_t, 80 * 80> minimap;
-	std::array<xy_t, 360> edge_points;
+	minimap_t minimap;
+	bool minimap_updated;
+	std::array<std::vector<xy_t>, edge_lod_count> edge_lod_list;
+	std::vector<xy_t> edge_arc;
+	// prey at [0, prey_list.size()), then snakes from kinematics_snake_list
+	kinematics_t kinematics;
+	std::vector<size_t> kinematics_snake_list;
+	job_system_t job_system;
+	// snake lists first, then food lists
+	std::vector<draw_list_t> draw_list_pool;
+	frame_arena_t frame_arena;  // draw thread, reset at the start of draw()
+	snake_t** snake_draw_list;  // in frame_arena, for the prepare jobs
+	uint64_t prepare_now_us;
+	size_t snake_draw_list_count;
+	size_t food_draw_list_count;
+	// per frame scratch for batch transforms, capacity is kept between frames
+	std::vector<xy_t> xy_screen_buf;
+	std::vector<uint32_t> xy_idx_buf;
 	leaderboard_t leaderboard;
 	score_t score;
 	float fps;
+	bool profile_overlay;
+	uint8_t pkt_type_cur;  // for PKT_REJECT in the handlers
+	pkt_stat_t pkt_stat;
+	pkt_stat_t pkt_stat_last;  // at the last snapshot
+	pkt_stat_t pkt_stat_prev;  // at the one before
+	std::mutex pkt_stat_lock;
+	pkt_stat_t pkt_stat_snap;  // under pkt_stat_lock, for other threads
+	game_snap_t snap;  // under pkt_stat_lock
 	ping_ctx_t ping_ctx;
+	send_spacing_t send_spacing;
+	watchdog_t watchdog;
 };
 #endif  // GAME_H
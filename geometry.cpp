@@ -1,5 +1,4 @@
 #include "geometry.h"
-#include "screen_sdl.h"
 #include "log.h"
 
 #include <cmath>
@@ -54,6 +53,18 @@ std::deque<xy_t> make_line_segment(const xy_t& p1, const xy_t& p2)
 	return segment;
 }
 
+arena_vector_t<xy_t> make_line_segment(frame_arena_t& arena, const xy_t& p1, const xy_t& p2)
+{
+	arena_vector_t<xy_t> segment{arena_allocator_t<xy_t>(arena)};
+	coordinate_t dist = distance(p1, p2);
+	segment.reserve(std::max<coordinate_t>(dist, 0));
+	for (ssize_t cnt = 0; cnt < dist; ++cnt)
+		segment.emplace_back(
+			xy_interpolate(p1, p2, cnt)
+			);
+	return segment;
+}
+
 xy_t matr_mul_xy(const matr33_t& matr, const xy_t& xy)
 {
 	matr33_row_t xy3{xy.x, xy.y, 1.};
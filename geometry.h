@@ -8,22 +8,66 @@
 #include <algorithm>
 #include <cmath>
 
+#include "arena.h"
+#include "fixed.h"
+
 typedef int32_t coordinate_t;
 
-struct xy_t
+// T is coordinate_t for whole game units or fixed_t<> for sub-unit precision
+template <typename T>
+struct basic_xy_t
 {
-	coordinate_t x;
-	coordinate_t y;
-	bool operator == (const xy_t& other)
+	T x;
+	T y;
+	bool operator == (const basic_xy_t& other) const
 	{
 		return x == other.x && y == other.y;
 	}
-	bool operator != (const xy_t& other)
+	bool operator != (const basic_xy_t& other) const
 	{
 		return x != other.x || y != other.y;
 	}
 };
 
+typedef basic_xy_t<coordinate_t> xy_t;
+
+// whole game units
+static inline coordinate_t coordinate_int(coordinate_t val)
+{
+	return val;
+}
+
+template <unsigned FRAC>
+static inline coordinate_t coordinate_int(fixed_t<FRAC> val)
+{
+	return val.to_int();
+}
+
+template <typename T>
+static inline xy_t xy_int(const basic_xy_t<T>& xy)
+{
+	return xy_t{coordinate_int(xy.x), coordinate_int(xy.y)};
+}
+
+// a + (b - a) * w, w is float for coordinate_t and float types, the same fixed_t otherwise
+template <typename T>
+struct coordinate_weight
+{
+	typedef float type;
+};
+
+template <unsigned FRAC>
+struct coordinate_weight<fixed_t<FRAC>>
+{
+	typedef fixed_t<FRAC> type;
+};
+
+template <typename T>
+static inline T coordinate_lerp(T a, T b, typename coordinate_weight<T>::type w)
+{
+	return a + (b - a) * w;
+}
+
 struct rect_t
 {
 	xy_t ul;
@@ -34,6 +78,24 @@ struct rect_t
 	xy_t center(){ return xy_t{(lr.x + ul.x) / 2, (lr.y + ul.y) / 2}; }
 	template <typename Txy>
 	bool has(const Txy& xy) const { return rect_has_xy(*this, xy); }
+	bool intersects(const rect_t& other) const
+	{
+		return ul.x <= other.lr.x && other.ul.x <= lr.x &&
+			ul.y <= other.lr.y && other.ul.y <= lr.y;
+	}
+	template <typename Txy>
+	void expand(const Txy& xy)
+	{
+		ul.x = std::min(ul.x, xy.x);
+		ul.y = std::min(ul.y, xy.y);
+		lr.x = std::max(lr.x, xy.x);
+		lr.y = std::max(lr.y, xy.y);
+	}
+	template <typename Txy>
+	bool on_border(const Txy& xy) const
+	{
+		return xy.x == ul.x || xy.x == lr.x || xy.y == ul.y || xy.y == lr.y;
+	}
 };
 
 template <typename Txy>
@@ -52,22 +114,22 @@ static inline bool rect_has_xy(const rect_t& rect, const Txy& xy)
 
 static inline coordinate_t distance(coordinate_t x1, coordinate_t y1, coordinate_t x2, coordinate_t y2)
 {
-	float dx2 = pow(x1 - x2, 2);
-	float dy2 = pow(y1 - y2, 2);
-	float distance = ::sqrtf(dx2 + dy2);
-	return static_cast<size_t>(distance);
+	const int64_t dx = x1 - x2;
+	const int64_t dy = y1 - y2;
+	float distance = ::sqrtf(dx * dx + dy * dy);
+	return static_cast<coordinate_t>(distance);
 }
 
 template <typename Txy1, typename Txy2>
 static inline coordinate_t distance(const Txy1& xy1, const Txy2& xy2)
 {
-	return distance(xy1.x, xy1.y, xy2.x, xy2.y);
+	return distance(coordinate_int(xy1.x), coordinate_int(xy1.y), coordinate_int(xy2.x), coordinate_int(xy2.y));
 }
 
 template <typename Txy>
 static inline std::string to_str(const Txy& xy)
 {
-	return std::string(std::to_string(xy.x) + std::string(":") + std::to_string(xy.y));
+	return std::string(std::to_string(coordinate_int(xy.x)) + std::string(":") + std::to_string(coordinate_int(xy.y)));
 }
 
 template <typename Txy_list, typename Txy>
@@ -81,10 +143,25 @@ find_by_xy(Txy_list& xy_list, Txy xy)
 		);
 }
 
+// pull every element from first on towards the previous one, [idx - 1] is moved before [idx]
+// weight is cst * idx / 4 up to idx 4, cst after that (slither.io snake body smoothing)
+template <typename T, typename Txy_list>
+void xy_list_squeeze(Txy_list& xy_list, size_t first, float cst)
+{
+	typedef typename coordinate_weight<T>::type weight_t;
+	weight_t w(0.);
+	for (size_t idx = first; idx < xy_list.size(); ++idx)
+	{
+		if (idx <= 4)
+			w = weight_t(cst * idx / 4.);
+		xy_list[idx].x = coordinate_lerp<T>(xy_list[idx].x, xy_list[idx - 1].x, w);
+		xy_list[idx].y = coordinate_lerp<T>(xy_list[idx].y, xy_list[idx - 1].y, w);
+	}
+}
+
 template <size_t N_SEG>
-std::vector<xy_t> make_quad_bezier(xy_t p1, xy_t p2, xy_t p3)
+void quad_bezier_fill(xy_t* pts, xy_t p1, xy_t p2, xy_t p3)
 {
-	std::vector<xy_t> pts(N_SEG + 1);
 	for (size_t idx = 0; idx < N_SEG + 1; ++idx)
 	{
 		float t = static_cast<float>(idx) / static_cast<float>(N_SEG);
@@ -94,6 +171,22 @@ std::vector<xy_t> make_quad_bezier(xy_t p1, xy_t p2, xy_t p3)
 		pts[idx].x = a * p1.x + b * p2.x + c * p3.x;
 		pts[idx].y = a * p1.y + b * p2.y + c * p3.y;
 	}
+}
+
+template <size_t N_SEG>
+std::vector<xy_t> make_quad_bezier(xy_t p1, xy_t p2, xy_t p3)
+{
+	std::vector<xy_t> pts(N_SEG + 1);
+	quad_bezier_fill<N_SEG>(pts.data(), p1, p2, p3);
+	return pts;
+}
+
+// N_SEG + 1 points valid until the arena is reset
+template <size_t N_SEG>
+const xy_t* make_quad_bezier(frame_arena_t& arena, xy_t p1, xy_t p2, xy_t p3)
+{
+	xy_t* pts = arena.alloc_array<xy_t>(N_SEG + 1);
+	quad_bezier_fill<N_SEG>(pts, p1, p2, p3);
 	return pts;
 }
 
@@ -116,7 +209,10 @@ octagon_t make_octastar(const coordinate_t x, const coordinate_t y, coordinate_t
 octagon_t make_octagon(const coordinate_t x, const coordinate_t y, coordinate_t radius);
 void line_segment_append(std::deque<xy_t>& segment, const xy_t& p1, const xy_t& p2);
 std::deque<xy_t> make_line_segment(const xy_t& p1, const xy_t& p2);
+arena_vector_t<xy_t> make_line_segment(frame_arena_t& arena, const xy_t& p1, const xy_t& p2);
 template <size_t N_SEG>
 std::vector<xy_t> make_quad_bezier(xy_t p1, xy_t p2, xy_t p3);
+template <size_t N_SEG>
+const xy_t* make_quad_bezier(frame_arena_t& arena, xy_t p1, xy_t p2, xy_t p3);
 
 #endif  // GEOMETRY_H
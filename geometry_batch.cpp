@@ -0,0 +1,297 @@
+#include "geometry_batch.h"
+#include "fast_trig.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static inline xy_t xy_transform_one(const xy_transform_t& xform, const xy_t& xy)
+{
+	xy_t out{
+		(xy.x - xform.center.x) * xform.scale,
+		(xy.y - xform.center.y) * xform.scale
+		};
+	out.x += xform.offset.x;
+	out.y += xform.offset.y;
+	return out;
+}
+
+// xy_t is two int32 so a 128 bit register holds 2 points, a 256 bit one 4 points
+// lanes are x, y, x, y...
+
+#if defined(__AVX2__)
+static const size_t batch_point_cnt = 4;
+
+static inline __m256i xy_transform_simd(__m256i xy, __m256i center, __m256 scale, __m256i offset)
+{
+	xy = _mm256_sub_epi32(xy, center);
+	xy = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(xy), scale));
+	return _mm256_add_epi32(xy, offset);
+}
+#elif defined(__SSE2__)
+static const size_t batch_point_cnt = 2;
+
+static inline __m128i xy_transform_simd(__m128i xy, __m128i center, __m128 scale, __m128i offset)
+{
+	xy = _mm_sub_epi32(xy, center);
+	xy = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(xy), scale));
+	return _mm_add_epi32(xy, offset);
+}
+#endif
+
+void xy_transform(const xy_transform_t& xform, const xy_t* xy_in, size_t count, xy_t* xy_out)
+{
+	size_t idx = 0;
+#if defined(__AVX2__)
+	const __m256i center = _mm256_setr_epi32(
+		xform.center.x, xform.center.y, xform.center.x, xform.center.y,
+		xform.center.x, xform.center.y, xform.center.x, xform.center.y);
+	const __m256i offset = _mm256_setr_epi32(
+		xform.offset.x, xform.offset.y, xform.offset.x, xform.offset.y,
+		xform.offset.x, xform.offset.y, xform.offset.x, xform.offset.y);
+	const __m256 scale = _mm256_set1_ps(xform.scale);
+	for (; idx + batch_point_cnt <= count; idx += batch_point_cnt)
+	{
+		__m256i xy = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(xy_in + idx));
+		xy = xy_transform_simd(xy, center, scale, offset);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(xy_out + idx), xy);
+	}
+#elif defined(__SSE2__)
+	const __m128i center = _mm_setr_epi32(xform.center.x, xform.center.y, xform.center.x, xform.center.y);
+	const __m128i offset = _mm_setr_epi32(xform.offset.x, xform.offset.y, xform.offset.x, xform.offset.y);
+	const __m128 scale = _mm_set1_ps(xform.scale);
+	for (; idx + batch_point_cnt <= count; idx += batch_point_cnt)
+	{
+		__m128i xy = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xy_in + idx));
+		xy = xy_transform_simd(xy, center, scale, offset);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(xy_out + idx), xy);
+	}
+#endif
+	for (; idx < count; ++idx)
+		xy_out[idx] = xy_transform_one(xform, xy_in[idx]);
+}
+
+size_t xy_transform_cull(const xy_transform_t& xform, const rect_t& rect,
+	const xy_t* xy_in, size_t count, xy_t* xy_out, uint32_t* idx_out)
+{
+	size_t out_cnt = 0;
+	size_t idx = 0;
+	// every point is stored and the output position is advanced only for visible ones,
+	// no branch on visibility
+#if defined(__AVX2__)
+	const __m256i center = _mm256_setr_epi32(
+		xform.center.x, xform.center.y, xform.center.x, xform.center.y,
+		xform.center.x, xform.center.y, xform.center.x, xform.center.y);
+	const __m256i offset = _mm256_setr_epi32(
+		xform.offset.x, xform.offset.y, xform.offset.x, xform.offset.y,
+		xform.offset.x, xform.offset.y, xform.offset.x, xform.offset.y);
+	const __m256 scale = _mm256_set1_ps(xform.scale);
+	const __m256i ul = _mm256_setr_epi32(
+		rect.ul.x, rect.ul.y, rect.ul.x, rect.ul.y, rect.ul.x, rect.ul.y, rect.ul.x, rect.ul.y);
+	const __m256i lr = _mm256_setr_epi32(
+		rect.lr.x, rect.lr.y, rect.lr.x, rect.lr.y, rect.lr.x, rect.lr.y, rect.lr.x, rect.lr.y);
+	alignas(32) xy_t xy_batch[batch_point_cnt];
+	for (; idx + batch_point_cnt <= count; idx += batch_point_cnt)
+	{
+		__m256i xy = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(xy_in + idx));
+		xy = xy_transform_simd(xy, center, scale, offset);
+		const __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi32(ul, xy), _mm256_cmpgt_epi32(xy, lr));
+		const int mask = _mm256_movemask_ps(_mm256_castsi256_ps(outside));
+		if (mask == 0xff)
+			continue;
+		_mm256_store_si256(reinterpret_cast<__m256i*>(xy_batch), xy);
+		for (size_t pt = 0; pt < batch_point_cnt; ++pt)
+		{
+			xy_out[out_cnt] = xy_batch[pt];
+			idx_out[out_cnt] = idx + pt;
+			out_cnt += ((mask >> (pt * 2)) & 3) == 0;
+		}
+	}
+#elif defined(__SSE2__)
+	const __m128i center = _mm_setr_epi32(xform.center.x, xform.center.y, xform.center.x, xform.center.y);
+	const __m128i offset = _mm_setr_epi32(xform.offset.x, xform.offset.y, xform.offset.x, xform.offset.y);
+	const __m128 scale = _mm_set1_ps(xform.scale);
+	const __m128i ul = _mm_setr_epi32(rect.ul.x, rect.ul.y, rect.ul.x, rect.ul.y);
+	const __m128i lr = _mm_setr_epi32(rect.lr.x, rect.lr.y, rect.lr.x, rect.lr.y);
+	alignas(16) xy_t xy_batch[batch_point_cnt];
+	for (; idx + batch_point_cnt <= count; idx += batch_point_cnt)
+	{
+		__m128i xy = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xy_in + idx));
+		xy = xy_transform_simd(xy, center, scale, offset);
+		const __m128i outside = _mm_or_si128(_mm_cmpgt_epi32(ul, xy), _mm_cmpgt_epi32(xy, lr));
+		const int mask = _mm_movemask_ps(_mm_castsi128_ps(outside));
+		if (mask == 0xf)
+			continue;
+		_mm_store_si128(reinterpret_cast<__m128i*>(xy_batch), xy);
+		for (size_t pt = 0; pt < batch_point_cnt; ++pt)
+		{
+			xy_out[out_cnt] = xy_batch[pt];
+			idx_out[out_cnt] = idx + pt;
+			out_cnt += ((mask >> (pt * 2)) & 3) == 0;
+		}
+	}
+#endif
+	for (; idx < count; ++idx)
+	{
+		const xy_t xy = xy_transform_one(xform, xy_in[idx]);
+		xy_out[out_cnt] = xy;
+		idx_out[out_cnt] = idx;
+		out_cnt += rect_has_xy(rect, xy);
+	}
+	return out_cnt;
+}
+
+#if defined(__SSE2__)
+// 4 points in two registers to x lanes and y lanes as float
+static inline void xy_deinterleave_ps(const xy_t* xy, __m128& x, __m128& y)
+{
+	const __m128 xy01 = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(xy)));
+	const __m128 xy23 = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(xy + 2)));
+	x = _mm_shuffle_ps(xy01, xy23, _MM_SHUFFLE(2, 0, 2, 0));
+	y = _mm_shuffle_ps(xy01, xy23, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+// truncate x lanes and y lanes and store as 4 points
+static inline void xy_interleave_store(__m128 x, __m128 y, xy_t* xy)
+{
+	const __m128i xi = _mm_cvttps_epi32(x);
+	const __m128i yi = _mm_cvttps_epi32(y);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(xy), _mm_unpacklo_epi32(xi, yi));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(xy + 2), _mm_unpackhi_epi32(xi, yi));
+}
+
+static inline __m128 norm_angle_ps(__m128 ang)
+{
+	// fmod(ang + 2 pi, 2 pi)
+	const __m128 pi2 = _mm_set1_ps(M_PI * 2);
+	const __m128 a = _mm_add_ps(ang, pi2);
+	const __m128 q = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_div_ps(a, pi2)));
+	return _mm_sub_ps(a, _mm_mul_ps(q, pi2));
+}
+#endif
+
+void distance_batch(const xy_t* xy1, const xy_t* xy2, size_t count, coordinate_t* out)
+{
+	size_t idx = 0;
+#if defined(__SSE2__)
+	for (; idx + 4 <= count; idx += 4)
+	{
+		__m128 x1, y1, x2, y2;
+		xy_deinterleave_ps(xy1 + idx, x1, y1);
+		xy_deinterleave_ps(xy2 + idx, x2, y2);
+		const __m128 dx = _mm_sub_ps(x1, x2);
+		const __m128 dy = _mm_sub_ps(y1, y2);
+		const __m128 dist = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + idx), _mm_cvttps_epi32(dist));
+	}
+#endif
+	for (; idx < count; ++idx)
+		out[idx] = distance(xy1[idx], xy2[idx]);
+}
+
+void xy_angle_batch(const xy_t* xy1, const xy_t* xy2, size_t count, float* out, trig_t trig)
+{
+	size_t idx = 0;
+	if (trig == trig_fast)
+	{
+#if defined(__SSE2__)
+		for (; idx + 4 <= count; idx += 4)
+		{
+			__m128 x1, y1, x2, y2;
+			xy_deinterleave_ps(xy1 + idx, x1, y1);
+			xy_deinterleave_ps(xy2 + idx, x2, y2);
+			const __m128 ang = fast_atan2_ps(_mm_sub_ps(y2, y1), _mm_sub_ps(x2, x1));
+			_mm_storeu_ps(out + idx, norm_angle_ps(ang));
+		}
+#endif
+		for (; idx < count; ++idx)
+		{
+			const float ang = fast_atan2f(xy2[idx].y - xy1[idx].y, xy2[idx].x - xy1[idx].x);
+			out[idx] = norm_angle(ang);
+		}
+		return;
+	}
+	for (; idx < count; ++idx)
+		out[idx] = xy_angle(xy1[idx], xy2[idx]);
+}
+
+void xy_rot_batch(const xy_t* xy_in, const float* ang_list, size_t count, xy_t center, xy_t* xy_out,
+	trig_t trig)
+{
+	size_t idx = 0;
+	if (trig == trig_fast)
+	{
+#if defined(__SSE2__)
+		const __m128 cx = _mm_set1_ps(center.x);
+		const __m128 cy = _mm_set1_ps(center.y);
+		for (; idx + 4 <= count; idx += 4)
+		{
+			const __m128 ang = _mm_loadu_ps(ang_list + idx);
+			const __m128 sin = fast_sin_ps(ang);
+			const __m128 cos = fast_cos_ps(ang);
+			__m128 x, y;
+			xy_deinterleave_ps(xy_in + idx, x, y);
+			x = _mm_sub_ps(x, cx);
+			y = _mm_sub_ps(y, cy);
+			const __m128 tx = _mm_sub_ps(_mm_mul_ps(x, cos), _mm_mul_ps(y, sin));
+			const __m128 ty = _mm_add_ps(_mm_mul_ps(x, sin), _mm_mul_ps(y, cos));
+			// xy_rot() truncates the rotated offset and then adds the center
+			const __m128 txt = _mm_cvtepi32_ps(_mm_cvttps_epi32(tx));
+			const __m128 tyt = _mm_cvtepi32_ps(_mm_cvttps_epi32(ty));
+			xy_interleave_store(_mm_add_ps(txt, cx), _mm_add_ps(tyt, cy), xy_out + idx);
+		}
+#endif
+		for (; idx < count; ++idx)
+		{
+			const float cos = fast_cosf(ang_list[idx]);
+			const float sin = fast_sinf(ang_list[idx]);
+			const coordinate_t x = xy_in[idx].x - center.x;
+			const coordinate_t y = xy_in[idx].y - center.y;
+			xy_t txy{(x * cos) - (y * sin), (x * sin) + (y * cos)};
+			xy_out[idx] = xy_t{txy.x + center.x, txy.y + center.y};
+		}
+		return;
+	}
+	for (; idx < count; ++idx)
+		xy_out[idx] = xy_rot(xy_in[idx], center, ang_list[idx]);
+}
+
+void norm_angle_batch(float* ang_list, size_t count)
+{
+	size_t idx = 0;
+#if defined(__SSE2__)
+	for (; idx + 4 <= count; idx += 4)
+		_mm_storeu_ps(ang_list + idx, norm_angle_ps(_mm_loadu_ps(ang_list + idx)));
+#endif
+	for (; idx < count; ++idx)
+		ang_list[idx] = norm_angle(ang_list[idx]);
+}
+
+void sincos_batch(const float* ang_list, size_t count, float* sin_out, float* cos_out, trig_t trig)
+{
+	size_t idx = 0;
+	if (trig == trig_fast)
+	{
+#if defined(__SSE2__)
+		for (; idx + 4 <= count; idx += 4)
+		{
+			const __m128 ang = _mm_loadu_ps(ang_list + idx);
+			_mm_storeu_ps(sin_out + idx, fast_sin_ps(ang));
+			_mm_storeu_ps(cos_out + idx, fast_cos_ps(ang));
+		}
+#endif
+		for (; idx < count; ++idx)
+		{
+			sin_out[idx] = fast_sinf(ang_list[idx]);
+			cos_out[idx] = fast_cosf(ang_list[idx]);
+		}
+		return;
+	}
+	for (; idx < count; ++idx)
+	{
+		sin_out[idx] = ::sinf(ang_list[idx]);
+		cos_out[idx] = ::cosf(ang_list[idx]);
+	}
+}
@@ -0,0 +1,47 @@
+#ifndef GEOMETRY_BATCH_H
+#define GEOMETRY_BATCH_H
+
+#include "geometry.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// out = (in - center) * scale + offset
+// same rounding as game_t::screen_xy()
+struct xy_transform_t
+{
+	xy_t center;
+	float scale;
+	xy_t offset;
+};
+
+// out may be the same array as in
+void xy_transform(const xy_transform_t& xform, const xy_t* xy_in, size_t count, xy_t* xy_out);
+
+// transform and keep only points inside rect (borders included)
+// xy_out and idx_out get the transformed point and its index in xy_in, both must hold count elements
+// returns number of points inside rect
+size_t xy_transform_cull(const xy_transform_t& xform, const rect_t& rect,
+	const xy_t* xy_in, size_t count, xy_t* xy_out, uint32_t* idx_out);
+
+// array in / array out variants of geometry.h functions
+// trig_fast uses fast_trig.h polynomials, see there for the error bounds
+
+enum trig_t
+{
+	trig_libm,
+	trig_fast
+};
+
+// distance(xy1[i], xy2[i]), may differ by 1 from distance() for distances over 4096
+void distance_batch(const xy_t* xy1, const xy_t* xy2, size_t count, coordinate_t* out);
+// xy_angle(xy1[i], xy2[i])
+void xy_angle_batch(const xy_t* xy1, const xy_t* xy2, size_t count, float* out, trig_t trig = trig_libm);
+// xy_rot(xy_in[i], center, ang_list[i]), xy_out may be the same array as xy_in
+void xy_rot_batch(const xy_t* xy_in, const float* ang_list, size_t count, xy_t center, xy_t* xy_out,
+	trig_t trig = trig_libm);
+// norm_angle() in place, within float rounding of norm_angle()
+void norm_angle_batch(float* ang_list, size_t count);
+void sincos_batch(const float* ang_list, size_t count, float* sin_out, float* cos_out, trig_t trig = trig_libm);
+
+#endif  // GEOMETRY_BATCH_H
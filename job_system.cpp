@@ -0,0 +1,136 @@
+#include "job_system.h"
+#include "log.h"
+#include "trace.h"
+
+job_system_t::job_system_t()
+: queue_list()
+, worker_list()
+, wake_lock()
+, wake_cv()
+, done_cv()
+, queued(0)
+, pending(0)
+, quit(false)
+, push_idx(0)
+{
+	queue_list.emplace_back(new queue_t());
+}
+
+job_system_t::~job_system_t()
+{
+	stop();
+}
+
+void job_system_t::start(size_t worker_count)
+{
+	stop();
+	for (size_t cnt = 0; cnt < worker_count; ++cnt)
+		queue_list.emplace_back(new queue_t());
+	for (size_t idx = 1; idx < queue_list.size(); ++idx)
+		worker_list.emplace_back(&job_system_t::worker_func, this, idx);
+	LOG("threads:%zu", thread_count());
+}
+
+void job_system_t::stop()
+{
+	if (worker_list.empty())
+		return;
+	wait();
+	{
+		std::lock_guard<std::mutex> lock_guard(wake_lock);
+		quit = true;
+	}
+	wake_cv.notify_all();
+	for (std::thread& worker : worker_list)
+		worker.join();
+	worker_list.clear();
+	queue_list.resize(1);
+	quit = false;
+	push_idx = 0;
+}
+
+void job_system_t::push(job_t job)
+{
+	queue_t& queue = *queue_list[push_idx];
+	push_idx = (push_idx + 1) % queue_list.size();
+	pending++;
+	{
+		std::lock_guard<std::mutex> lock_guard(queue.lock);
+		queue.job_list.push_back(std::move(job));
+		queued++;
+	}
+	if (worker_list.empty())
+		return;
+	{
+		std::lock_guard<std::mutex> lock_guard(wake_lock);
+	}
+	wake_cv.notify_one();
+}
+
+bool job_system_t::job_pop(size_t queue_idx, job_t& job)
+{
+	{
+		queue_t& queue = *queue_list[queue_idx];
+		std::lock_guard<std::mutex> lock_guard(queue.lock);
+		if (!queue.empty())
+		{
+			job = std::move(queue.job_list.back());
+			queue.job_list.pop_back();
+			queue.pop_done();
+			queued--;
+			return true;
+		}
+	}
+	for (size_t cnt = 1; cnt < queue_list.size(); ++cnt)
+	{
+		queue_t& queue = *queue_list[(queue_idx + cnt) % queue_list.size()];
+		std::lock_guard<std::mutex> lock_guard(queue.lock);
+		if (!queue.empty())
+		{
+			job = std::move(queue.job_list[queue.first++]);
+			queue.pop_done();
+			queued--;
+			return true;
+		}
+	}
+	return false;
+}
+
+void job_system_t::job_run(job_t& job)
+{
+	job();
+	job = nullptr;
+	if (--pending != 0)
+		return;
+	{
+		std::lock_guard<std::mutex> lock_guard(wake_lock);
+	}
+	done_cv.notify_all();
+}
+
+void job_system_t::worker_func(size_t queue_idx)
+{
+	trace_thread_name("job");
+	job_t job;
+	while (true)
+	{
+		if (job_pop(queue_idx, job))
+		{
+			job_run(job);
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(wake_lock);
+		wake_cv.wait(lock, [this](){ return quit || queued > 0; });
+		if (quit)
+			return;
+	}
+}
+
+void job_system_t::wait()
+{
+	job_t job;
+	while (job_pop(0, job))
+		job_run(job);
+	std::unique_lock<std::mutex> lock(wake_lock);
+	done_cv.wait(lock, [this](){ return pending == 0; });
+}
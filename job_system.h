@@ -0,0 +1,71 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <stddef.h>
+
+// Work stealing job pool.
+// Every thread has its own deque, it takes jobs from the back of its own deque
+// and steals from the front of the others when that is empty.
+// Jobs are pushed and waited for by one thread (the SDL thread), which runs jobs too
+// while it waits. Without start() all jobs run on that thread inside wait().
+struct job_system_t
+{
+	typedef std::function<void()> job_t;
+
+	job_system_t();
+	~job_system_t();
+	// worker_count threads besides the one calling wait()
+	void start(size_t worker_count);
+	void stop();
+	void push(job_t job);
+	// run and steal jobs until all pushed jobs are done, jobs must not push
+	void wait();
+	size_t thread_count() const { return queue_list.size(); }
+
+	// a vector rather than a deque, its capacity is kept so steady state pushes do not allocate
+	struct queue_t
+	{
+		queue_t()
+		: first(0)
+		{
+		}
+
+		bool empty() const { return first == job_list.size(); }
+		void pop_done()
+		{
+			if (empty())
+			{
+				job_list.clear();
+				first = 0;
+			}
+		}
+
+		std::mutex lock;
+		std::vector<job_t> job_list;
+		size_t first;  // next to steal, job_list before it is moved out
+	};
+
+	bool job_pop(size_t queue_idx, job_t& job);
+	void job_run(job_t& job);
+	void worker_func(size_t queue_idx);
+
+	std::vector<std::unique_ptr<queue_t>> queue_list;  // [0] belongs to the thread calling wait()
+	std::vector<std::thread> worker_list;
+	std::mutex wake_lock;
+	std::condition_variable wake_cv;  // jobs queued or quit
+	std::condition_variable done_cv;  // pending dropped to 0
+	std::atomic<size_t> queued;
+	std::atomic<size_t> pending;  // queued and running
+	bool quit;
+	size_t push_idx;
+};
+
+#endif  // JOB_SYSTEM_H
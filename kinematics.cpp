@@ -0,0 +1,71 @@
+#include "kinematics.h"
+#include "fast_trig.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+void kinematics_t::clear()
+{
+	x.clear();
+	y.clear();
+	heading.clear();
+	turn_rate.clear();
+	speed.clear();
+	tstamp_us.clear();
+}
+
+size_t kinematics_t::add(xy_t xy, float heading_, float turn_rate_, float speed_, uint64_t tstamp_us_)
+{
+	x.push_back(xy.x);
+	y.push_back(xy.y);
+	heading.push_back(heading_);
+	turn_rate.push_back(turn_rate_);
+	speed.push_back(speed_);
+	tstamp_us.push_back(tstamp_us_);
+	return x.size() - 1;
+}
+
+static inline xy_t kinematics_one(coordinate_t x, coordinate_t y,
+	float heading, float turn_rate, float speed, float delta_us)
+{
+	// a long unupdated turn runs past the range fast_cosf/fast_sinf are exact in
+	const float angle = fast_wrap_angle(heading + turn_rate * delta_us);
+	const coordinate_t dist = speed * delta_us * (1.f / 1000000.f);
+	return xy_t{
+		static_cast<float>(x) + fast_cosf(angle) * dist,
+		static_cast<float>(y) + fast_sinf(angle) * dist
+		};
+}
+
+void kinematics_t::extrapolate(uint64_t now_us)
+{
+	const size_t count = size();
+	delta_us.resize(count);
+	xy_out.resize(count);
+	// timestamps in the future (network delay estimate went down) count as no movement
+	for (size_t idx = 0; idx < count; ++idx)
+		delta_us[idx] = now_us > tstamp_us[idx] ? now_us - tstamp_us[idx] : 0;
+
+	size_t idx = 0;
+#if defined(__SSE2__)
+	const __m128 us_per_s_inv = _mm_set1_ps(1.f / 1000000.f);
+	for (; idx + 4 <= count; idx += 4)
+	{
+		const __m128 dt = _mm_loadu_ps(&delta_us[idx]);
+		const __m128 angle = fast_wrap_angle_ps(_mm_add_ps(_mm_loadu_ps(&heading[idx]),
+			_mm_mul_ps(_mm_loadu_ps(&turn_rate[idx]), dt)));
+		// truncate distance to whole game units like the scalar path
+		__m128 dist = _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(&speed[idx]), dt), us_per_s_inv);
+		dist = _mm_cvtepi32_ps(_mm_cvttps_epi32(dist));
+		const __m128 x0 = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&x[idx])));
+		const __m128 y0 = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&y[idx])));
+		const __m128i x1 = _mm_cvttps_epi32(_mm_add_ps(x0, _mm_mul_ps(fast_cos_ps(angle), dist)));
+		const __m128i y1 = _mm_cvttps_epi32(_mm_add_ps(y0, _mm_mul_ps(fast_sin_ps(angle), dist)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&xy_out[idx]), _mm_unpacklo_epi32(x1, y1));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&xy_out[idx + 2]), _mm_unpackhi_epi32(x1, y1));
+	}
+#endif
+	for (; idx < count; ++idx)
+		xy_out[idx] = kinematics_one(x[idx], y[idx], heading[idx], turn_rate[idx], speed[idx], delta_us[idx]);
+}
@@ -0,0 +1,34 @@
+#ifndef KINEMATICS_H
+#define KINEMATICS_H
+
+#include "geometry.h"
+
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Dead reckoning of snake heads and prey, one entity per index.
+// At time t, with dt = t - tstamp_us (microseconds):
+// angle = heading + turn_rate * dt
+// xy_out = xy + (cos(angle), sin(angle)) * (coordinate_t)(speed * dt / 1e6)
+struct kinematics_t
+{
+	void clear();
+	// returns index of the entity
+	size_t add(xy_t xy, float heading, float turn_rate, float speed, uint64_t tstamp_us);
+	// fills xy_out for all entities in one pass
+	void extrapolate(uint64_t now_us);
+	size_t size() const { return x.size(); }
+
+	std::vector<coordinate_t> x;
+	std::vector<coordinate_t> y;
+	std::vector<float> heading;  // rad
+	std::vector<float> turn_rate;  // rad per us
+	std::vector<float> speed;  // game units per second
+	std::vector<uint64_t> tstamp_us;
+	std::vector<float> delta_us;
+	std::vector<xy_t> xy_out;
+};
+
+#endif  // KINEMATICS_H
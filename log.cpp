@@ -0,0 +1,325 @@
+#include "log.h"
+#include "util.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+std::atomic<uint32_t> log_generation(1);
+
+static const size_t log_ring_size = 1 << 18;  // bytes per thread
+static const uint64_t log_drain_period_us = 10000;
+
+struct log_rec_hdr_t
+{
+	const log_site_t* site;  // nullptr - padding up to the ring end
+	uint64_t tstamp_ms;
+	uint32_t size;  // of the arguments after the header
+};
+
+static const size_t log_align = alignof(log_rec_hdr_t);
+
+static size_t log_align_up(size_t size)
+{
+	return (size + log_align - 1) & ~(log_align - 1);
+}
+
+// written by its own thread only, read by the log thread only
+struct log_ring_t
+{
+	log_ring_t()
+	: buf(log_ring_size)
+	, head(0)
+	, tail(0)
+	, head_next(0)
+	, drop_cnt(0)
+	{
+	}
+
+	std::vector<uint8_t> buf;
+	std::atomic<size_t> head;  // bytes written, committed
+	std::atomic<size_t> tail;  // bytes read
+	size_t head_next;  // head after the reserved record
+	std::atomic<size_t> drop_cnt;
+};
+
+static log_level_t log_level = log_level_err;
+static std::vector<std::string> log_category_list;
+static std::mutex config_lock;
+static std::mutex ring_list_lock;
+static std::vector<std::unique_ptr<log_ring_t>> ring_list;  // kept after their threads end
+static thread_local log_ring_t* ring_local;
+static FILE* log_fh;
+static std::thread writer;
+static std::mutex writer_lock;
+static std::condition_variable writer_cv;
+static bool writer_quit;
+
+void log_site_update(log_site_t& site, uint32_t generation)
+{
+	std::lock_guard<std::mutex> lock_guard(config_lock);
+	bool enabled = site.level <= log_level;
+	if (enabled && !log_category_list.empty())
+	{
+		std::string category = basename(site.file);
+		category = category.substr(0, category.find('.'));
+		enabled = std::find(log_category_list.begin(), log_category_list.end(), category) !=
+			log_category_list.end();
+	}
+	site.enabled.store(enabled, std::memory_order_relaxed);
+	site.generation.store(generation, std::memory_order_relaxed);
+}
+
+static log_ring_t& ring_get()
+{
+	if (ring_local != nullptr)
+		return *ring_local;
+	std::unique_ptr<log_ring_t> ring(new log_ring_t());
+	ring_local = ring.get();
+	std::lock_guard<std::mutex> lock_guard(ring_list_lock);
+	ring_list.push_back(std::move(ring));
+	return *ring_local;
+}
+
+uint8_t* log_reserve(const log_site_t& site, size_t size)
+{
+	log_ring_t& ring = ring_get();
+	const size_t head = ring.head.load(std::memory_order_relaxed);
+	const size_t rec_size = log_align_up(sizeof(log_rec_hdr_t) + size);
+	size_t offset = head % log_ring_size;
+	// records do not wrap, the rest of the ring is skipped
+	size_t pad = 0;
+	if (offset + rec_size > log_ring_size)
+		pad = log_ring_size - offset;
+	if (rec_size > log_ring_size ||
+		head + pad + rec_size - ring.tail.load(std::memory_order_acquire) > log_ring_size)
+	{
+		ring.drop_cnt.fetch_add(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+	if (pad >= sizeof(log_rec_hdr_t))
+	{
+		const log_rec_hdr_t pad_hdr{nullptr, 0, 0};
+		memcpy(&ring.buf[offset], &pad_hdr, sizeof(pad_hdr));
+	}
+	offset = (head + pad) % log_ring_size;
+	const log_rec_hdr_t hdr{&site, LOG_TSTAMP_MS(), static_cast<uint32_t>(size)};
+	memcpy(&ring.buf[offset], &hdr, sizeof(hdr));
+	ring.head_next = head + pad + rec_size;
+	return &ring.buf[offset + sizeof(hdr)];
+}
+
+void log_commit()
+{
+	log_ring_t& ring = *ring_local;
+	ring.head.store(ring.head_next, std::memory_order_release);
+}
+
+// one printf conversion of format at fmt, with the argument at arg
+// returns the format position after the conversion and moves arg past the argument
+static const char* log_conv(std::string& out, const char* fmt, const uint8_t*& arg, const uint8_t* arg_end)
+{
+	const char* spec_begin = fmt++;  // at '%'
+	while (*fmt != 0 && strchr("-+ #0", *fmt) != nullptr)
+		++fmt;
+	while (*fmt >= '0' && *fmt <= '9')
+		++fmt;
+	if (*fmt == '.')
+		for (++fmt; *fmt >= '0' && *fmt <= '9'; ++fmt)
+			;
+	std::string spec(spec_begin, fmt);
+	while (*fmt != 0 && strchr("hljztL", *fmt) != nullptr)
+		++fmt;
+	const char conv = *fmt;
+	if (conv == 0)
+		return fmt;
+	++fmt;
+	if (conv == '%')
+	{
+		out += '%';
+		return fmt;
+	}
+	if (arg >= arg_end)
+	{
+		out += "<missing>";
+		return fmt;
+	}
+	char buf[320];
+	const uint8_t type = *arg++;
+	uint64_t raw = 0;
+	switch (type)
+	{
+		case log_arg_int:
+		case log_arg_uint:
+			memcpy(&raw, arg, sizeof(raw));
+			arg += sizeof(raw);
+			if (strchr("fFeEgGaA", conv) != nullptr)
+				snprintf(buf, sizeof(buf), (spec + conv).c_str(),
+					type == log_arg_int ? 1. * static_cast<int64_t>(raw) : 1. * raw);
+			else if (conv == 'c')
+				snprintf(buf, sizeof(buf), (spec + 'c').c_str(), static_cast<int>(raw));
+			else if (type == log_arg_int && (conv == 'd' || conv == 'i'))
+				snprintf(buf, sizeof(buf), (spec + "lld").c_str(), static_cast<long long>(raw));
+			else
+				snprintf(buf, sizeof(buf), (spec + "ll" + (strchr("uxXo", conv) ? conv : 'u')).c_str(),
+					static_cast<unsigned long long>(raw));
+			break;
+		case log_arg_double:
+		{
+			double val;
+			memcpy(&val, arg, sizeof(val));
+			arg += sizeof(val);
+			snprintf(buf, sizeof(buf), (spec + (strchr("fFeEgGaA", conv) ? conv : 'f')).c_str(), val);
+			break;
+		}
+		case log_arg_str:
+		{
+			const size_t len = *arg++;
+			const std::string str(reinterpret_cast<const char*>(arg), len);
+			arg += len;
+			snprintf(buf, sizeof(buf), (spec + 's').c_str(), str.c_str());
+			break;
+		}
+		case log_arg_ptr:
+		{
+			uintptr_t ptr;
+			memcpy(&ptr, arg, sizeof(ptr));
+			arg += sizeof(ptr);
+			snprintf(buf, sizeof(buf), "%p", reinterpret_cast<void*>(ptr));
+			break;
+		}
+		default:
+			arg = arg_end;
+			snprintf(buf, sizeof(buf), "<bad arg>");
+			break;
+	}
+	out += buf;
+	return fmt;
+}
+
+static void log_rec_write(const log_rec_hdr_t& hdr, const uint8_t* arg)
+{
+	const log_site_t& site = *hdr.site;
+	const uint8_t* arg_end = arg + hdr.size;
+	std::string out;
+	for (const char* fmt = site.format; *fmt != 0; )
+	{
+		if (*fmt != '%')
+			out += *fmt++;
+		else
+			fmt = log_conv(out, fmt, arg, arg_end);
+	}
+	fprintf(log_fh, "[%06lu] %s:%d:%s\n", hdr.tstamp_ms, site.func, site.line, out.c_str());
+}
+
+static void ring_drain(log_ring_t& ring)
+{
+	const size_t head = ring.head.load(std::memory_order_acquire);
+	size_t tail = ring.tail.load(std::memory_order_relaxed);
+	while (tail != head)
+	{
+		const size_t offset = tail % log_ring_size;
+		const size_t rest = log_ring_size - offset;
+		if (rest < sizeof(log_rec_hdr_t))
+		{
+			tail += rest;
+			continue;
+		}
+		log_rec_hdr_t hdr;
+		memcpy(&hdr, &ring.buf[offset], sizeof(hdr));
+		if (hdr.site == nullptr)
+		{
+			tail += rest;
+			continue;
+		}
+		log_rec_write(hdr, &ring.buf[offset + sizeof(hdr)]);
+		tail += log_align_up(sizeof(hdr) + hdr.size);
+	}
+	ring.tail.store(tail, std::memory_order_release);
+}
+
+static void ring_list_drain()
+{
+	std::lock_guard<std::mutex> lock_guard(ring_list_lock);
+	for (std::unique_ptr<log_ring_t>& ring : ring_list)
+		ring_drain(*ring);
+	fflush(log_fh);
+}
+
+static void writer_func()
+{
+	std::unique_lock<std::mutex> lock(writer_lock);
+	while (!writer_quit)
+	{
+		writer_cv.wait_for(lock, std::chrono::microseconds(log_drain_period_us));
+		lock.unlock();
+		ring_list_drain();
+		lock.lock();
+	}
+}
+
+bool log_start(const std::string& level, const std::string& category_list, const std::string& path)
+{
+	log_level_t level_new = log_level_err;
+	if (level == "info")
+		level_new = log_level_info;
+	else if (level == "debug")
+		level_new = log_level_debug;
+	else if (level != "err" && !level.empty())
+	{
+		ERR("unknown log_level:%s", level.c_str());
+		return false;
+	}
+	log_fh = stdout;
+	if (!path.empty())
+	{
+		log_fh = fopen(path.c_str(), "w");
+		if (log_fh == nullptr)
+		{
+			ERR("can not open file:%s", path.c_str());
+			log_fh = stdout;
+			return false;
+		}
+	}
+	{
+		std::lock_guard<std::mutex> lock_guard(config_lock);
+		log_level = level_new;
+		log_category_list.clear();
+		if (!category_list.empty())
+			log_category_list = split_str(category_list, ",");
+	}
+	writer_quit = false;
+	writer = std::thread(writer_func);
+	log_generation++;
+	return true;
+}
+
+void log_stop()
+{
+	if (!writer.joinable())
+		return;
+	{
+		std::lock_guard<std::mutex> lock_guard(config_lock);
+		log_level = log_level_err;
+	}
+	log_generation++;
+	{
+		std::lock_guard<std::mutex> lock_guard(writer_lock);
+		writer_quit = true;
+	}
+	writer_cv.notify_all();
+	writer.join();
+	ring_list_drain();
+	std::lock_guard<std::mutex> lock_guard(ring_list_lock);
+	for (std::unique_ptr<log_ring_t>& ring : ring_list)
+	{
+		const size_t drop_cnt = ring->drop_cnt.exchange(0);
+		if (drop_cnt > 0)
+			ERR("log records dropped:%zu", drop_cnt);
+	}
+	if (log_fh != stdout)
+		fclose(log_fh);
+	log_fh = nullptr;
+}
@@ -7,55 +7,178 @@
 #include <stdarg.h>
 
 #ifdef RUN_TIME
-
-#ifdef DEBUG_LOG
-#define LOG(format, ...) do{ \
-				printf( \
-					"[%06lu] %s:%d:" format "\n", \
-					run_time_us() / 1000, \
-					__FUNCTION__, \
-					__LINE__, \
-					##__VA_ARGS__); \
-				}while(0)
+#define LOG_TSTAMP_MS() (run_time_us() / 1000)
 #else
-#define LOG(...)
-#endif  // DEBUG_LOG
-
-#define ERR(format, ...) do{ \
-				fprintf(stderr, \
-					"[%06lu] %s:%d:" format "\n", \
-					run_time_us() / 1000, \
-					__FUNCTION__, \
-					__LINE__, \
-					##__VA_ARGS__); \
-				}while(0)
-#else  // RUN_TIME
-
-#ifdef DEBUG_LOG
-#define LOG(format, ...) do{ \
-				printf( \
-					"[%06lu] %s:%d:" format "\n", \
-					uptime_us() / 1000, \
-					__FUNCTION__, \
-					__LINE__, \
-					##__VA_ARGS__); \
-				}while(0)
-#else
-#define LOG(...)
-#endif  // DEBUG_LOG
+#define LOG_TSTAMP_MS() (uptime_us() / 1000)
+#endif  // RUN_TIME
 
 #define ERR(format, ...) do{ \
 				fprintf(stderr, \
 					"[%06lu] %s:%d:" format "\n", \
-					uptime_us() / 1000, \
+					LOG_TSTAMP_MS(), \
 					__FUNCTION__, \
 					__LINE__, \
 					##__VA_ARGS__); \
 				}while(0)
-#endif  // RUN_TIME
 
 #ifdef __cplusplus
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <string>
+#include <type_traits>
+
+#include <stdint.h>
+#include <string.h>
+
+// Asynchronous binary log.
+// A LOG call site copies a pointer to its static log_site_t and the raw arguments into
+// a lock free ring of the calling thread, the log thread started by log_start() formats
+// and writes them. Strings are copied, up to 255 bytes. A full ring drops the record.
+// Sites are switched at run time by level and category, the category is the source
+// file name without extension ("game", "connect", ...). ERR stays synchronous.
+
+enum log_level_t
+{
+	log_level_err,
+	log_level_info,
+	log_level_debug
+};
+
+struct log_site_t
+{
+	constexpr log_site_t(const char* format_, const char* func_, const char* file_, int line_, log_level_t level_)
+	: format(format_)
+	, func(func_)
+	, file(file_)
+	, line(line_)
+	, level(level_)
+	, generation(0)
+	, enabled(false)
+	{
+	}
+
+	const char* format;
+	const char* func;
+	const char* file;
+	int line;
+	log_level_t level;
+	std::atomic<uint32_t> generation;  // log_generation enabled was worked out for
+	std::atomic<bool> enabled;
+};
+
+extern std::atomic<uint32_t> log_generation;  // bumped by log_start(), starts at 1
+
+// level: err, info or debug, category_list: comma separated, empty - all,
+// path: empty - stdout
+bool log_start(const std::string& level, const std::string& category_list, const std::string& path);
+void log_stop();
+void log_site_update(log_site_t& site, uint32_t generation);
+
+static inline bool log_on(log_site_t& site)
+{
+	const uint32_t generation = log_generation.load(std::memory_order_relaxed);
+	if (site.generation.load(std::memory_order_relaxed) != generation)
+		log_site_update(site, generation);
+	return site.enabled.load(std::memory_order_relaxed);
+}
+
+enum log_arg_type_t : uint8_t
+{
+	log_arg_int,
+	log_arg_uint,
+	log_arg_double,
+	log_arg_str,
+	log_arg_ptr
+};
+
+static const size_t log_str_max = 255;
+
+template <typename T>
+static inline typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value, size_t>::type
+log_arg_size(const T&) { return 1 + sizeof(uint64_t); }
+template <typename T>
+static inline typename std::enable_if<std::is_floating_point<T>::value, size_t>::type
+log_arg_size(const T&) { return 1 + sizeof(double); }
+static inline size_t log_arg_size(const char* str) { return 2 + std::min(strlen(str), log_str_max); }
+static inline size_t log_arg_size(const void*) { return 1 + sizeof(uintptr_t); }
+
+template <typename T>
+static inline typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value, uint8_t*>::type
+log_arg_put(uint8_t* buf, const T& val)
+{
+	const bool is_signed = std::is_signed<typename std::conditional<std::is_enum<T>::value, int, T>::type>::value;
+	*buf = is_signed ? log_arg_int : log_arg_uint;
+	const uint64_t raw = is_signed ? static_cast<uint64_t>(static_cast<int64_t>(val)) : static_cast<uint64_t>(val);
+	memcpy(buf + 1, &raw, sizeof(raw));
+	return buf + 1 + sizeof(raw);
+}
+template <typename T>
+static inline typename std::enable_if<std::is_floating_point<T>::value, uint8_t*>::type
+log_arg_put(uint8_t* buf, const T& val)
+{
+	*buf = log_arg_double;
+	const double raw = val;
+	memcpy(buf + 1, &raw, sizeof(raw));
+	return buf + 1 + sizeof(raw);
+}
+static inline uint8_t* log_arg_put(uint8_t* buf, const char* str)
+{
+	const size_t len = std::min(strlen(str), log_str_max);
+	buf[0] = log_arg_str;
+	buf[1] = len;
+	memcpy(buf + 2, str, len);
+	return buf + 2 + len;
+}
+static inline uint8_t* log_arg_put(uint8_t* buf, const void* ptr)
+{
+	*buf = log_arg_ptr;
+	const uintptr_t raw = reinterpret_cast<uintptr_t>(ptr);
+	memcpy(buf + 1, &raw, sizeof(raw));
+	return buf + 1 + sizeof(raw);
+}
+
+static inline size_t log_args_size() { return 0; }
+template <typename T, typename... Targs>
+static inline size_t log_args_size(const T& arg, const Targs&... args)
+{
+	return log_arg_size(arg) + log_args_size(args...);
+}
+
+static inline void log_args_put(uint8_t*) {}
+template <typename T, typename... Targs>
+static inline void log_args_put(uint8_t* buf, const T& arg, const Targs&... args)
+{
+	log_args_put(log_arg_put(buf, arg), args...);
+}
+
+// space for size bytes of arguments in the calling thread's ring, nullptr when full
+uint8_t* log_reserve(const log_site_t& site, size_t size);
+void log_commit();
+
+template <typename... Targs>
+static inline void log_write(const log_site_t& site, const Targs&... args)
+{
+	uint8_t* buf = log_reserve(site, log_args_size(args...));
+	if (buf == nullptr)
+		return;
+	log_args_put(buf, args...);
+	log_commit();
+}
+
+// compile time printf format check only, never called
+static inline void log_format_check(const char*, ...) __attribute__((format(printf, 1, 2)));
+static inline void log_format_check(const char*, ...) {}
+
+#define LOG_AT(level, format, ...) do{ \
+				static log_site_t log_site_(format, __FUNCTION__, __FILE__, __LINE__, level); \
+				if (false) \
+					log_format_check("%s:" format, __FUNCTION__, ##__VA_ARGS__); \
+				if (log_on(log_site_)) \
+					log_write(log_site_, ##__VA_ARGS__); \
+				}while(0)
+#define LOG(format, ...) LOG_AT(log_level_debug, format, ##__VA_ARGS__)
+#define LOG_INFO(format, ...) LOG_AT(log_level_info, format, ##__VA_ARGS__)
 
 #ifdef DEBUG_LOG
 #define LOGCC std::cout << __FUNCTION__ << ":" << __LINE__ << ": "
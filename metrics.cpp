@@ -0,0 +1,144 @@
+#include "metrics.h"
+#include "ioc.h"
+#include "log.h"
+#include "trace.h"
+
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include <string.h>
+
+namespace http = boost::beast::http;
+using tcp = boost::asio::ip::tcp;
+
+static std::unique_ptr<tcp::acceptor> acceptor;
+static metrics_text_func_t metrics_text;
+static std::thread metrics_thread;
+
+static const std::chrono::seconds metrics_timeout(5);
+
+// one request per connection, scrapes are rare and small
+// async with a deadline so a silent client can not hold the only metrics thread
+struct metrics_session_t : public std::enable_shared_from_this<metrics_session_t>
+{
+	explicit metrics_session_t(tcp::socket socket)
+	: stream(std::move(socket))
+	, buffer()
+	, req()
+	, res()
+	{
+	}
+
+	void read()
+	{
+		stream.expires_after(metrics_timeout);
+		std::shared_ptr<metrics_session_t> self = shared_from_this();
+		http::async_read(stream, buffer, req,
+			[self](boost::system::error_code ec, size_t)
+			{
+				if (!ec)
+					self->write();
+			});
+	}
+
+	void write()
+	{
+		res.version(req.version());
+		if (req.target() == "/" || req.target() == "/metrics")
+		{
+			res.result(http::status::ok);
+			res.set(http::field::content_type, "text/plain; version=0.0.4");
+			res.body() = metrics_text();
+		}
+		else
+			res.result(http::status::not_found);
+		res.keep_alive(false);
+		res.prepare_payload();
+		stream.expires_after(metrics_timeout);
+		std::shared_ptr<metrics_session_t> self = shared_from_this();
+		http::async_write(stream, res,
+			[self](boost::system::error_code ec, size_t)
+			{
+				if (!ec)
+					self->stream.socket().shutdown(tcp::socket::shutdown_send, ec);
+			});
+	}
+
+	boost::beast::tcp_stream stream;
+	boost::beast::flat_buffer buffer;
+	http::request<http::string_body> req;
+	http::response<http::string_body> res;
+};
+
+static void metrics_accept()
+{
+	acceptor->async_accept(
+		[](boost::system::error_code ec, tcp::socket socket)
+		{
+			if (ec)
+				return;  // closed by metrics_stop()
+			std::make_shared<metrics_session_t>(std::move(socket))->read();
+			metrics_accept();
+		});
+}
+
+bool metrics_start(unsigned short port, metrics_text_func_t text_func)
+{
+	boost::system::error_code ec;
+	acceptor.reset(new tcp::acceptor(ioc_get()));
+	const tcp::endpoint endpoint{boost::asio::ip::address_v4::loopback(), port};
+	acceptor->open(endpoint.protocol(), ec);
+	if (!ec)
+		acceptor->set_option(boost::asio::socket_base::reuse_address(true), ec);
+	if (!ec)
+		acceptor->bind(endpoint, ec);
+	if (!ec)
+		acceptor->listen(boost::asio::socket_base::max_listen_connections, ec);
+	if (ec)
+	{
+		ERR("metrics_port:%u %s", port, ec.message().c_str());
+		acceptor.reset();
+		return false;
+	}
+	metrics_text = text_func;
+	metrics_accept();
+	metrics_thread = std::thread([]()
+		{
+			trace_thread_name("metrics");
+			ioc_get().run();
+		});
+	LOG_INFO("metrics_port:%u", port);
+	return true;
+}
+
+void metrics_stop()
+{
+	if (acceptor == nullptr)
+		return;
+	// run() returns once the open sessions are done, metrics_timeout at most
+	boost::asio::post(ioc_get(), []() { acceptor->close(); });
+	metrics_thread.join();
+	acceptor.reset();
+	ioc_get().restart();
+}
+
+void metrics_add(std::string& text, const char* type, const char* name, double value)
+{
+	char buf[256];
+	// the TYPE line names the metric without labels, once per metric
+	const char* label = strchr(name, '{');
+	const size_t name_len = label != nullptr ? label - name : strlen(name);
+	const size_t type_pos = text.rfind("# TYPE ");
+	if (type_pos == std::string::npos || text.compare(type_pos + 7, name_len, name, name_len) != 0 ||
+		text[type_pos + 7 + name_len] != ' ')
+	{
+		snprintf(buf, sizeof(buf), "# TYPE %.*s %s\n", static_cast<int>(name_len), name, type);
+		text += buf;
+	}
+	snprintf(buf, sizeof(buf), "%s %.9g\n", name, value);
+	text += buf;
+}
@@ -0,0 +1,21 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <functional>
+#include <string>
+
+// Plain text metrics page in the Prometheus exposition format.
+// metrics_start() listens on port with the ioc_get() io_context, run by its own thread,
+// and answers every request with what text_func returns at that moment, so text_func
+// must only read state that is safe to read from another thread.
+
+typedef std::function<std::string()> metrics_text_func_t;
+
+bool metrics_start(unsigned short port, metrics_text_func_t text_func);
+void metrics_stop();
+
+// "name value\n" with a TYPE line, labels go into name
+// the TYPE line is written when the family differs from the last one, add each family as one group
+void metrics_add(std::string& text, const char* type, const char* name, double value);
+
+#endif  // METRICS_H
@@ -0,0 +1,113 @@
+#include "profile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+static std::mutex zone_list_lock;
+static std::vector<profile_zone_t*> zone_list;
+static uint64_t tick_tstamp;
+
+static const uint64_t profile_period_us = 1000000;
+
+profile_zone_t::profile_zone_t(const char* name_)
+: name(name_)
+, hist()
+, max_ns(0)
+, alloc_cnt(0)
+, alloc_bytes(0)
+, frame_ns(0)
+, frame_cnt(0)
+, stat()
+{
+	for (std::atomic<uint32_t>& count : hist.count_list)
+		count.store(0, std::memory_order_relaxed);
+	std::lock_guard<std::mutex> lock_guard(zone_list_lock);
+	zone_list.push_back(this);
+}
+
+static profile_stat_t stat_make(const uint64_t* count_list, uint64_t max_ns)
+{
+	profile_stat_t stat{};
+	for (size_t idx = 0; idx < profile_hist_t::bucket_count; ++idx)
+		stat.count += count_list[idx];
+	stat.max_ns = max_ns;
+	if (stat.count == 0)
+		return stat;
+	const uint64_t p50_cnt = (stat.count * 50 + 99) / 100;
+	const uint64_t p99_cnt = (stat.count * 99 + 99) / 100;
+	uint64_t cnt = 0;
+	for (size_t idx = 0; idx < profile_hist_t::bucket_count; ++idx)
+	{
+		if (count_list[idx] == 0)
+			continue;
+		const uint64_t cnt_prev = cnt;
+		cnt += count_list[idx];
+		const uint64_t value = std::min(profile_hist_t::bucket_value(idx), max_ns);
+		if (cnt_prev < p50_cnt && cnt >= p50_cnt)
+			stat.p50_ns = value;
+		if (cnt_prev < p99_cnt && cnt >= p99_cnt)
+		{
+			stat.p99_ns = value;
+			break;
+		}
+	}
+	return stat;
+}
+
+uint64_t profile_hist_percentile(const profile_hist_t& hist, double p)
+{
+	uint64_t total = 0;
+	for (const std::atomic<uint32_t>& count : hist.count_list)
+		total += count.load(std::memory_order_relaxed);
+	if (total == 0)
+		return 0;
+	const uint64_t target = std::max<uint64_t>(1, std::ceil(p * total));
+	uint64_t cnt = 0;
+	for (size_t idx = 0; idx < profile_hist_t::bucket_count; ++idx)
+	{
+		cnt += hist.count_list[idx].load(std::memory_order_relaxed);
+		if (cnt >= target)
+			return profile_hist_t::bucket_value(idx);
+	}
+	return profile_hist_t::bucket_value(profile_hist_t::bucket_count - 1);
+}
+
+bool profile_tick(uint64_t now_us)
+{
+	if (now_us - tick_tstamp < profile_period_us)
+		return false;
+	tick_tstamp = now_us;
+	uint64_t count_list[profile_hist_t::bucket_count];
+	std::lock_guard<std::mutex> lock_guard(zone_list_lock);
+	for (profile_zone_t* zone : zone_list)
+	{
+		for (size_t idx = 0; idx < profile_hist_t::bucket_count; ++idx)
+			count_list[idx] = zone->hist.count_list[idx].exchange(0, std::memory_order_relaxed);
+		zone->stat = stat_make(count_list, zone->max_ns.exchange(0, std::memory_order_relaxed));
+		zone->stat.alloc_cnt = zone->alloc_cnt.exchange(0, std::memory_order_relaxed);
+		zone->stat.alloc_bytes = zone->alloc_bytes.exchange(0, std::memory_order_relaxed);
+	}
+	return true;
+}
+
+std::vector<const profile_zone_t*> profile_zone_list()
+{
+	std::lock_guard<std::mutex> lock_guard(zone_list_lock);
+	return std::vector<const profile_zone_t*>(zone_list.begin(), zone_list.end());
+}
+
+size_t profile_frame_take(profile_frame_stat_t* stat_list, size_t stat_max)
+{
+	size_t stat_cnt = 0;
+	std::lock_guard<std::mutex> lock_guard(zone_list_lock);
+	for (profile_zone_t* zone : zone_list)
+	{
+		const uint32_t count = zone->frame_cnt.exchange(0, std::memory_order_relaxed);
+		const uint64_t ns = zone->frame_ns.exchange(0, std::memory_order_relaxed);
+		if (count == 0 || stat_cnt == stat_max)
+			continue;
+		stat_list[stat_cnt++] = profile_frame_stat_t{zone->name, ns, count};
+	}
+	return stat_cnt;
+}
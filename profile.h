@@ -1,23 +1,142 @@
 #ifndef PROFILE_H
 #define PROFILE_H
 
-#include <chrono>
+#include "alloc.h"
+#include "clock.h"
+#include "trace.h"
 
-struct profile_t
+#include <atomic>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Scoped timers aggregated per zone into log linear histograms.
+// PROFILE_ZONE("name") times the rest of the enclosing scope, the name must be a
+// string literal. Zones can be hit from any thread, profile_tick() on the draw thread
+// turns the histograms into profile_stat_t once per second. With alloc_track_on the
+// heap allocations of the scope are counted too, nested zones included.
+
+// values below sub_count are exact, above each power of 2 has sub_count buckets (~6%)
+struct profile_hist_t
+{
+	static const unsigned sub_bits = 4;
+	static const uint64_t sub_count = 1 << sub_bits;
+	static const unsigned value_bits = 36;  // ~68 s in ns, longer is clamped
+	static const size_t bucket_count = (value_bits - sub_bits + 1) * sub_count;
+
+	static size_t bucket(uint64_t value)
+	{
+		if (value < sub_count)
+			return value;
+		if (value >= (uint64_t(1) << value_bits))
+			value = (uint64_t(1) << value_bits) - 1;
+		const unsigned shift = 63 - __builtin_clzll(value) - sub_bits;
+		return (shift + 1) * sub_count + ((value >> shift) & (sub_count - 1));
+	}
+
+	// upper bound of the values in bucket idx
+	static uint64_t bucket_value(size_t idx)
+	{
+		if (idx < sub_count)
+			return idx;
+		const unsigned shift = idx / sub_count - 1;
+		return ((sub_count + idx % sub_count + 1) << shift) - 1;
+	}
+
+	std::atomic<uint32_t> count_list[bucket_count];
+};
+
+struct profile_stat_t
+{
+	uint64_t count;
+	uint64_t p50_ns;
+	uint64_t p99_ns;
+	uint64_t max_ns;
+	uint64_t alloc_cnt;
+	uint64_t alloc_bytes;
+};
+
+// zone time since the last profile_frame_take()
+struct profile_frame_stat_t
+{
+	const char* name;
+	uint64_t ns;
+	uint32_t count;
+};
+
+struct profile_zone_t
 {
-	using namespace std::chrono;
-	profile_t()
-	: start(steady_clock::now())
-	{}
-	~profile_t(){}
-	size_t elapsed_ms()
+	explicit profile_zone_t(const char* name_);
+
+	void add(uint64_t ns)
 	{
-		return duration_cast<microseconds>steady_clock::now() - start;
+		hist.count_list[profile_hist_t::bucket(ns)].fetch_add(1, std::memory_order_relaxed);
+		uint64_t max_prev = max_ns.load(std::memory_order_relaxed);
+		while (ns > max_prev && !max_ns.compare_exchange_weak(max_prev, ns, std::memory_order_relaxed))
+			;
+		frame_ns.fetch_add(ns, std::memory_order_relaxed);
+		frame_cnt.fetch_add(1, std::memory_order_relaxed);
 	}
-	
-	steady_clock::time_point start;
+
+	void alloc_add(uint64_t cnt, uint64_t bytes)
+	{
+		alloc_cnt.fetch_add(cnt, std::memory_order_relaxed);
+		alloc_bytes.fetch_add(bytes, std::memory_order_relaxed);
+	}
+
 	const char* name;
-	size_t line;
+	profile_hist_t hist;  // current second
+	std::atomic<uint64_t> max_ns;
+	std::atomic<uint64_t> alloc_cnt;
+	std::atomic<uint64_t> alloc_bytes;
+	std::atomic<uint64_t> frame_ns;  // current frame
+	std::atomic<uint32_t> frame_cnt;
+	profile_stat_t stat;  // last full second
+};
+
+struct profile_scope_t
+{
+	explicit profile_scope_t(profile_zone_t& zone_)
+	: zone(zone_)
+	, alloc_start(alloc_track_on.load(std::memory_order_relaxed) ? &alloc_count() : nullptr)
+	, alloc_cnt_start(alloc_start != nullptr ? alloc_start->alloc_cnt : 0)
+	, alloc_bytes_start(alloc_start != nullptr ? alloc_start->alloc_bytes : 0)
+	, start_ns(uptime_ns())
+	{
+	}
+
+	~profile_scope_t()
+	{
+		const uint64_t end_ns = uptime_ns();
+		zone.add(end_ns - start_ns);
+		if (alloc_start != nullptr)
+			zone.alloc_add(alloc_start->alloc_cnt - alloc_cnt_start, alloc_start->alloc_bytes - alloc_bytes_start);
+		if (trace_on.load(std::memory_order_relaxed))
+			trace_event(zone.name, start_ns, end_ns);
+	}
+
+	profile_zone_t& zone;
+	const alloc_count_t* alloc_start;  // nullptr - not tracking
+	uint64_t alloc_cnt_start;
+	uint64_t alloc_bytes_start;
+	uint64_t start_ns;
 };
 
-#endif
+#define PROFILE_CAT_(a, b) a##b
+#define PROFILE_CAT(a, b) PROFILE_CAT_(a, b)
+#define PROFILE_ZONE(name) \
+	static profile_zone_t PROFILE_CAT(profile_zone_, __LINE__)(name); \
+	profile_scope_t PROFILE_CAT(profile_scope_, __LINE__)(PROFILE_CAT(profile_zone_, __LINE__))
+
+// moves the current histograms to profile_zone_t::stat when a second passed since the last move
+// returns true when it did
+bool profile_tick(uint64_t now_us);
+// zones in the order they were first hit
+std::vector<const profile_zone_t*> profile_zone_list();
+// upper bound of the value at percentile p (0 - 1) of the histogram, 0 when empty
+uint64_t profile_hist_percentile(const profile_hist_t& hist, double p);
+// once per frame, the zones hit since the last call, returns how many went to stat_list
+size_t profile_frame_take(profile_frame_stat_t* stat_list, size_t stat_max);
+
+#endif  // PROFILE_H
@@ -0,0 +1,328 @@
+#include "raster_soft.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+raster_soft_t::raster_soft_t()
+: width(0)
+, height(0)
+, tile_cols(0)
+, tile_rows(0)
+, frame()
+, cmd_list()
+, tile_list()
+, job_system(nullptr)
+{
+}
+
+void raster_soft_t::start(coordinate_t width_, coordinate_t height_, job_system_t& job_system_)
+{
+	width = width_;
+	height = height_;
+	frame.assign(static_cast<size_t>(width) * height, 0);
+	tile_cols = (width + tile_size - 1) / tile_size;
+	tile_rows = (height + tile_size - 1) / tile_size;
+	tile_list.assign(tile_cols * tile_rows, std::vector<uint32_t>());
+	cmd_list.clear();
+	job_system = &job_system_;
+}
+
+// x0 and x1 included
+static inline void span_fill(raster_soft_t::pixel_t* row, coordinate_t x0, coordinate_t x1,
+	raster_soft_t::pixel_t color)
+{
+#if defined(__SSE2__)
+	const __m128i color4 = _mm_set1_epi32(color);
+	for (; x0 + 3 <= x1; x0 += 4)
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(row + x0), color4);
+#endif
+	for (; x0 <= x1; ++x0)
+		row[x0] = color;
+}
+
+void raster_soft_t::cmd_push(const cmd_t& cmd)
+{
+	const rect_t& bbox = cmd.bbox;
+	if (bbox.lr.x < 0 || bbox.lr.y < 0 || bbox.ul.x >= width || bbox.ul.y >= height)
+		return;
+	if (bbox.ul.x > bbox.lr.x || bbox.ul.y > bbox.lr.y)
+		return;
+	const uint32_t cmd_idx = cmd_list.size();
+	cmd_list.push_back(cmd);
+	const coordinate_t tx0 = std::max<coordinate_t>(bbox.ul.x, 0) / tile_size;
+	const coordinate_t ty0 = std::max<coordinate_t>(bbox.ul.y, 0) / tile_size;
+	const coordinate_t tx1 = std::min<coordinate_t>(bbox.lr.x, width - 1) / tile_size;
+	const coordinate_t ty1 = std::min<coordinate_t>(bbox.lr.y, height - 1) / tile_size;
+	for (coordinate_t ty = ty0; ty <= ty1; ++ty)
+		for (coordinate_t tx = tx0; tx <= tx1; ++tx)
+			tile_list[ty * tile_cols + tx].push_back(cmd_idx);
+}
+
+void raster_soft_t::clear(pixel_t color)
+{
+	// everything recorded so far would be overdrawn
+	cmd_list.clear();
+	for (std::vector<uint32_t>& tile : tile_list)
+		tile.clear();
+	fill(rect_t{xy_t{0, 0}, xy_t{width - 1, height - 1}}, color);
+}
+
+void raster_soft_t::fill(const rect_t& rect, pixel_t color)
+{
+	cmd_t cmd{};
+	cmd.type = cmd_fill;
+	cmd.color = color;
+	cmd.bbox = rect;
+	cmd_push(cmd);
+}
+
+void raster_soft_t::point(xy_t xy, pixel_t color)
+{
+	fill(rect_t{xy, xy}, color);
+}
+
+void raster_soft_t::line(xy_t p0, xy_t p1, pixel_t color)
+{
+	cmd_t cmd{};
+	cmd.type = cmd_line;
+	cmd.color = color;
+	cmd.bbox = rect_t{p0, p0};
+	cmd.bbox.expand(p1);
+	cmd.x[0] = p0.x;
+	cmd.y[0] = p0.y;
+	cmd.x[1] = p1.x;
+	cmd.y[1] = p1.y;
+	cmd_push(cmd);
+}
+
+void raster_soft_t::triangle(float x0, float y0, float x1, float y1, float x2, float y2, pixel_t color)
+{
+	cmd_t cmd{};
+	cmd.type = cmd_triangle;
+	cmd.color = color;
+	cmd.bbox.ul.x = std::floor(std::min(std::min(x0, x1), x2));
+	cmd.bbox.ul.y = std::floor(std::min(std::min(y0, y1), y2));
+	cmd.bbox.lr.x = std::ceil(std::max(std::max(x0, x1), x2));
+	cmd.bbox.lr.y = std::ceil(std::max(std::max(y0, y1), y2));
+	cmd.x[0] = x0;
+	cmd.y[0] = y0;
+	cmd.x[1] = x1;
+	cmd.y[1] = y1;
+	cmd.x[2] = x2;
+	cmd.y[2] = y2;
+	cmd_push(cmd);
+}
+
+void raster_soft_t::circle(xy_t center, coordinate_t radius, pixel_t color)
+{
+	cmd_t cmd{};
+	cmd.type = cmd_circle;
+	cmd.color = color;
+	cmd.bbox = rect_t{
+		xy_t{center.x - radius, center.y - radius},
+		xy_t{center.x + radius, center.y + radius}};
+	cmd.x[0] = center.x;
+	cmd.y[0] = center.y;
+	cmd.x[1] = radius;
+	cmd_push(cmd);
+}
+
+void raster_soft_t::octagon(xy_t center, coordinate_t radius, pixel_t color)
+{
+	const octagon_t oct = make_octagon(center.x, center.y, radius);
+	for (size_t cnt = 0; cnt < oct.size(); ++cnt)
+		line(oct[cnt], oct[(cnt + 1) % oct.size()], color);
+}
+
+void raster_soft_t::octastar(xy_t center, coordinate_t radius, pixel_t color)
+{
+	const octagon_t oct = make_octastar(center.x, center.y, radius);
+	for (const xy_t& xy : oct)
+		line(center, xy, color);
+}
+
+void raster_soft_t::blit(const uint8_t* mask, coordinate_t mask_width, coordinate_t mask_height,
+	const rect_t& dst, pixel_t color)
+{
+	if (mask == nullptr || mask_width <= 0 || mask_height <= 0)
+		return;
+	cmd_t cmd{};
+	cmd.type = cmd_blit;
+	cmd.color = color;
+	cmd.bbox = dst;
+	cmd.mask = mask;
+	cmd.mask_width = mask_width;
+	cmd.mask_height = mask_height;
+	cmd_push(cmd);
+}
+
+void raster_soft_t::flush()
+{
+	for (size_t tile_idx = 0; tile_idx < tile_list.size(); ++tile_idx)
+	{
+		if (tile_list[tile_idx].empty())
+			continue;
+		job_system->push([this, tile_idx](){ tile_draw(tile_idx); });
+	}
+	job_system->wait();
+	cmd_list.clear();
+	for (std::vector<uint32_t>& tile : tile_list)
+		tile.clear();
+}
+
+void raster_soft_t::tile_draw(size_t tile_idx)
+{
+	const coordinate_t tx = tile_idx % tile_cols;
+	const coordinate_t ty = tile_idx / tile_cols;
+	const rect_t tile{
+		xy_t{tx * tile_size, ty * tile_size},
+		xy_t{std::min(tx * tile_size + tile_size, width) - 1, std::min(ty * tile_size + tile_size, height) - 1}};
+	for (uint32_t cmd_idx : tile_list[tile_idx])
+	{
+		const cmd_t& cmd = cmd_list[cmd_idx];
+		switch (cmd.type)
+		{
+			case cmd_fill: fill_draw(cmd, tile); break;
+			case cmd_line: line_draw(cmd, tile); break;
+			case cmd_triangle: triangle_draw(cmd, tile); break;
+			case cmd_circle: circle_draw(cmd, tile); break;
+			case cmd_blit: blit_draw(cmd, tile); break;
+			default: break;
+		}
+	}
+}
+
+void raster_soft_t::fill_draw(const cmd_t& cmd, const rect_t& tile)
+{
+	const coordinate_t x0 = std::max(cmd.bbox.ul.x, tile.ul.x);
+	const coordinate_t x1 = std::min(cmd.bbox.lr.x, tile.lr.x);
+	const coordinate_t y0 = std::max(cmd.bbox.ul.y, tile.ul.y);
+	const coordinate_t y1 = std::min(cmd.bbox.lr.y, tile.lr.y);
+	for (coordinate_t y = y0; y <= y1; ++y)
+		span_fill(&frame[y * width], x0, x1, cmd.color);
+}
+
+// narrow [t0, t1] to where p + d * t is within [lo, hi]
+static inline bool clip_param(float p, float d, float lo, float hi, float& t0, float& t1)
+{
+	if (d == 0.)
+		return p >= lo && p <= hi;
+	float ta = (lo - p) / d;
+	float tb = (hi - p) / d;
+	if (ta > tb)
+		std::swap(ta, tb);
+	t0 = std::max(t0, ta);
+	t1 = std::min(t1, tb);
+	return t0 <= t1;
+}
+
+// DDA over the whole line, only steps that can land in the tile are walked
+// so every tile plots the same pixels a single pass would
+void raster_soft_t::line_draw(const cmd_t& cmd, const rect_t& tile)
+{
+	const float dx = cmd.x[1] - cmd.x[0];
+	const float dy = cmd.y[1] - cmd.y[0];
+	const coordinate_t steps = std::max(std::fabs(dx), std::fabs(dy));
+	float t0 = 0.;
+	float t1 = 1.;
+	if (!clip_param(cmd.x[0], dx, tile.ul.x - 1, tile.lr.x + 1, t0, t1))
+		return;
+	if (!clip_param(cmd.y[0], dy, tile.ul.y - 1, tile.lr.y + 1, t0, t1))
+		return;
+	const coordinate_t step_first = std::max<coordinate_t>(std::floor(t0 * steps) - 1, 0);
+	const coordinate_t step_last = std::min<coordinate_t>(std::ceil(t1 * steps) + 1, steps);
+	for (coordinate_t step = step_first; step <= step_last; ++step)
+	{
+		const float t = steps == 0 ? 0. : 1.f * step / steps;
+		const coordinate_t x = std::floor(cmd.x[0] + dx * t + 0.5f);
+		const coordinate_t y = std::floor(cmd.y[0] + dy * t + 0.5f);
+		if (!rect_has_xy(tile, xy_t{x, y}))
+			continue;
+		frame[y * width + x] = cmd.color;
+	}
+}
+
+// pixel centers inside the triangle, row by row
+void raster_soft_t::triangle_draw(const cmd_t& cmd, const rect_t& tile)
+{
+	const coordinate_t y0 = std::max(cmd.bbox.ul.y, tile.ul.y);
+	const coordinate_t y1 = std::min(cmd.bbox.lr.y, tile.lr.y);
+	for (coordinate_t y = y0; y <= y1; ++y)
+	{
+		const float yc = y + 0.5f;
+		float xl = width;
+		float xr = -1.;
+		for (size_t edge = 0; edge < 3; ++edge)
+		{
+			const float ax = cmd.x[edge];
+			const float ay = cmd.y[edge];
+			const float bx = cmd.x[(edge + 1) % 3];
+			const float by = cmd.y[(edge + 1) % 3];
+			if ((ay <= yc && by > yc) || (by <= yc && ay > yc))
+			{
+				const float x = ax + (yc - ay) * (bx - ax) / (by - ay);
+				xl = std::min(xl, x);
+				xr = std::max(xr, x);
+			}
+		}
+		if (xl > xr)
+			continue;
+		const coordinate_t x0 = std::max<coordinate_t>(std::ceil(xl - 0.5f), tile.ul.x);
+		const coordinate_t x1 = std::min<coordinate_t>(std::floor(xr - 0.5f), tile.lr.x);
+		if (x0 <= x1)
+			span_fill(&frame[y * width], x0, x1, cmd.color);
+	}
+}
+
+// midpoint circle outline
+void raster_soft_t::circle_draw(const cmd_t& cmd, const rect_t& tile)
+{
+	const coordinate_t cx = cmd.x[0];
+	const coordinate_t cy = cmd.y[0];
+	coordinate_t x = cmd.x[1];
+	coordinate_t y = 0;
+	coordinate_t err = 1 - x;
+	while (x >= y)
+	{
+		const xy_t xy_list[] = {
+			{cx + x, cy + y}, {cx + y, cy + x}, {cx - y, cy + x}, {cx - x, cy + y},
+			{cx - x, cy - y}, {cx - y, cy - x}, {cx + y, cy - x}, {cx + x, cy - y}};
+		for (const xy_t& xy : xy_list)
+			if (rect_has_xy(tile, xy))
+				frame[xy.y * width + xy.x] = cmd.color;
+		y++;
+		if (err < 0)
+			err += 2 * y + 1;
+		else
+		{
+			x--;
+			err += 2 * (y - x) + 1;
+		}
+	}
+}
+
+void raster_soft_t::blit_draw(const cmd_t& cmd, const rect_t& tile)
+{
+	const coordinate_t dst_width = cmd.bbox.lr.x - cmd.bbox.ul.x + 1;
+	const coordinate_t dst_height = cmd.bbox.lr.y - cmd.bbox.ul.y + 1;
+	const coordinate_t x0 = std::max(cmd.bbox.ul.x, tile.ul.x);
+	const coordinate_t x1 = std::min(cmd.bbox.lr.x, tile.lr.x);
+	const coordinate_t y0 = std::max(cmd.bbox.ul.y, tile.ul.y);
+	const coordinate_t y1 = std::min(cmd.bbox.lr.y, tile.lr.y);
+	for (coordinate_t y = y0; y <= y1; ++y)
+	{
+		const coordinate_t my = (y - cmd.bbox.ul.y) * cmd.mask_height / dst_height;
+		const uint8_t* mask_row = cmd.mask + my * cmd.mask_width;
+		pixel_t* row = &frame[y * width];
+		for (coordinate_t x = x0; x <= x1; ++x)
+		{
+			const coordinate_t mx = (x - cmd.bbox.ul.x) * cmd.mask_width / dst_width;
+			if (mask_row[mx])
+				row[x] = cmd.color;
+		}
+	}
+}
@@ -0,0 +1,83 @@
+#ifndef RASTER_SOFT_H
+#define RASTER_SOFT_H
+
+#include "geometry.h"
+#include "job_system.h"
+
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CPU rasteriser for screen_sdl_t renderer=soft.
+// Draw calls are recorded and binned to tile_size square tiles, flush() rasterises
+// the tiles in parallel, each tile runs its commands in the order they were made.
+// Pixels are ARGB8888, frame is width * height, row after row.
+struct raster_soft_t
+{
+	typedef uint32_t pixel_t;
+	static const coordinate_t tile_size = 64;
+
+	raster_soft_t();
+	// flush() runs the tiles on job_system_, pushed and waited for by the thread calling it,
+	// so it can be the game's pool as long as its jobs are done before flush()
+	void start(coordinate_t width_, coordinate_t height_, job_system_t& job_system_);
+
+	void clear(pixel_t color);
+	void fill(const rect_t& rect, pixel_t color);  // lr included
+	void point(xy_t xy, pixel_t color);
+	void line(xy_t p0, xy_t p1, pixel_t color);
+	void triangle(float x0, float y0, float x1, float y1, float x2, float y2, pixel_t color);
+	void circle(xy_t center, coordinate_t radius, pixel_t color);
+	void octagon(xy_t center, coordinate_t radius, pixel_t color);
+	void octastar(xy_t center, coordinate_t radius, pixel_t color);
+	// non zero mask pixels get color, mask is scaled to dst (nearest), must live until flush()
+	void blit(const uint8_t* mask, coordinate_t mask_width, coordinate_t mask_height,
+		const rect_t& dst, pixel_t color);
+	void flush();
+
+	static pixel_t color_make(uint8_t r, uint8_t g, uint8_t b)
+	{
+		return 0xff000000 | (uint32_t(r) << 16) | (uint32_t(g) << 8) | b;
+	}
+
+	enum cmd_type_t
+	{
+		cmd_fill,
+		cmd_line,
+		cmd_triangle,
+		cmd_circle,
+		cmd_blit
+	};
+
+	struct cmd_t
+	{
+		cmd_type_t type;
+		pixel_t color;
+		rect_t bbox;  // lr included
+		float x[3];
+		float y[3];
+		const uint8_t* mask;
+		coordinate_t mask_width;
+		coordinate_t mask_height;
+	};
+
+	void cmd_push(const cmd_t& cmd);
+	void tile_draw(size_t tile_idx);
+	void fill_draw(const cmd_t& cmd, const rect_t& tile);
+	void line_draw(const cmd_t& cmd, const rect_t& tile);
+	void triangle_draw(const cmd_t& cmd, const rect_t& tile);
+	void circle_draw(const cmd_t& cmd, const rect_t& tile);
+	void blit_draw(const cmd_t& cmd, const rect_t& tile);
+
+	coordinate_t width;
+	coordinate_t height;
+	coordinate_t tile_cols;
+	coordinate_t tile_rows;
+	std::vector<pixel_t> frame;
+	std::vector<cmd_t> cmd_list;
+	std::vector<std::vector<uint32_t>> tile_list;  // cmd_list indexes per tile
+	job_system_t* job_system;  // not owned
+};
+
+#endif  // RASTER_SOFT_H
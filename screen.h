@@ -0,0 +1,92 @@
+#ifndef SCREEN_H
+#define SCREEN_H
+
+#include "geometry.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// What game_t draws to and reads the mouse from.
+// screen_sdl_t (screen_sdl.h) is the window, screen_null_t (screen_null.h) draws nothing
+// so game code runs headless without SDL.
+struct screen_t
+{
+	screen_t(coordinate_t width_, coordinate_t height_)
+	: width(width_)
+	, height(height_)
+	, texture_cnt(0)
+	{
+	}
+
+	virtual ~screen_t() {}
+
+	struct color_t
+	{
+		color_t()
+		: r(0)
+		, g(0)
+		, b(0)
+		{
+		}
+
+		color_t(uint8_t r_, uint8_t g_, uint8_t b_)
+		: r(r_)
+		, g(g_)
+		, b(b_)
+		{
+		}
+
+		bool operator == (const color_t& other) const
+		{
+			return (
+				r == other.r &&
+				g == other.g &&
+				b == other.b
+				);
+		}
+
+		bool operator != (const color_t& other) const
+		{
+			return ! (*this == other);
+		}
+
+		uint8_t r;
+		uint8_t g;
+		uint8_t b;
+	};
+
+	virtual void clear() = 0;
+	// game field drawing between these two may be rendered at render_scale resolution
+	virtual void scene_begin(float render_scale) = 0;
+	virtual void scene_end() = 0;
+	virtual void point(coordinate_t x, coordinate_t y, color_t color) = 0;
+	virtual void line(coordinate_t x, coordinate_t y, coordinate_t x1, coordinate_t y1, color_t color) = 0;
+	// connected line through all points
+	virtual void lines(const xy_t* xy_list, size_t count, color_t color) = 0;
+	// filled band of half width radius along the line, flat ends, nothing for count < 2
+	virtual void ribbon(const xy_t* xy_list, size_t count, float radius, color_t color) = 0;
+	virtual void rect(coordinate_t x, coordinate_t y, coordinate_t x1, coordinate_t y1, color_t color) = 0;
+	virtual void circle(coordinate_t x, coordinate_t y, coordinate_t radius, color_t color) = 0;
+	virtual void octastar(coordinate_t x, coordinate_t y, coordinate_t radius, color_t color) = 0;
+	virtual void octagon(coordinate_t x, coordinate_t y, coordinate_t radius, color_t color) = 0;
+	virtual void text(coordinate_t x, coordinate_t y, color_t color, coordinate_t size, const char* text) = 0;
+	// 1 bit per pixel bitmap (see bitmap.h), call only when it changes
+	virtual void bitmap_update(const uint64_t* word_list, coordinate_t width_, coordinate_t height_) = 0;
+	// draw the last updated bitmap
+	virtual void bitmap(coordinate_t x, coordinate_t y, float scale, color_t color) = 0;
+	virtual bool mouse_position(coordinate_t& x, coordinate_t& y) = 0;
+	// wheel steps since the last call, positive away from the user
+	virtual int mouse_wheel() = 0;
+	virtual bool mouse_button_left() = 0;
+	// true once per press, key is the lower case ASCII character
+	virtual bool key_pressed(int key) = 0;
+	virtual void present() = 0;
+	// rendered strings kept for reuse
+	virtual size_t text_cache_size() const { return 0; }
+
+	coordinate_t width;
+	coordinate_t height;
+	size_t texture_cnt;  // textures created so far, for slow frame reports
+};
+
+#endif  // SCREEN_H
@@ -0,0 +1,70 @@
+#ifndef SCREEN_NULL_H
+#define SCREEN_NULL_H
+
+#include "screen.h"
+
+// Headless screen, drawing is dropped.
+// The mouse is whatever mouse_xy and button_left are set to, the window centre by default
+// so the snake keeps its direction.
+struct screen_null_t : public screen_t
+{
+	screen_null_t(coordinate_t width_, coordinate_t height_)
+	: screen_t(width_, height_)
+	, mouse_xy{width_ / 2, height_ / 2}
+	, button_left(false)
+	, wheel(0)
+	, present_cnt(0)
+	{
+	}
+
+	void clear() override {}
+	void scene_begin(float) override {}
+	void scene_end() override {}
+	void point(coordinate_t, coordinate_t, color_t) override {}
+	void line(coordinate_t, coordinate_t, coordinate_t, coordinate_t, color_t) override {}
+	void lines(const xy_t*, size_t, color_t) override {}
+	void ribbon(const xy_t*, size_t, float, color_t) override {}
+	void rect(coordinate_t, coordinate_t, coordinate_t, coordinate_t, color_t) override {}
+	void circle(coordinate_t, coordinate_t, coordinate_t, color_t) override {}
+	void octastar(coordinate_t, coordinate_t, coordinate_t, color_t) override {}
+	void octagon(coordinate_t, coordinate_t, coordinate_t, color_t) override {}
+	void text(coordinate_t, coordinate_t, color_t, coordinate_t, const char*) override {}
+	void bitmap_update(const uint64_t*, coordinate_t, coordinate_t) override {}
+	void bitmap(coordinate_t, coordinate_t, float, color_t) override {}
+
+	bool mouse_position(coordinate_t& x, coordinate_t& y) override
+	{
+		x = mouse_xy.x;
+		y = mouse_xy.y;
+		return true;
+	}
+
+	int mouse_wheel() override
+	{
+		int steps = wheel;
+		wheel = 0;
+		return steps;
+	}
+
+	bool mouse_button_left() override
+	{
+		return button_left;
+	}
+
+	bool key_pressed(int) override
+	{
+		return false;
+	}
+
+	void present() override
+	{
+		present_cnt++;
+	}
+
+	xy_t mouse_xy;
+	bool button_left;
+	int wheel;
+	size_t present_cnt;
+};
+
+#endif  // SCREEN_NULL_H
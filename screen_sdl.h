@@ -5,16 +5,20 @@
 #include <SDL2/SDL_ttf.h>
 
 #include "log.h"
+#include "screen.h"
+#include "trace.h"
 #include "geometry.h"
+#include "geometry_batch.h"
+#include "raster_soft.h"
 
+#include <bitset>
 #include <cassert>
 #include <unordered_map>
 
-struct screen_sdl_t
+struct screen_sdl_t : public screen_t
 {
 	explicit screen_sdl_t(coordinate_t width_, coordinate_t height_, std::string font_path)
-	: width(width_)
-	, height(height_)
+	: screen_t(width_, height_)
 	, window()
 	, renderer()
 	, event()
@@ -23,9 +27,25 @@ struct screen_sdl_t
 	, y_prev(0)
 	, quit(false)
 	, text_texture_map()
-	, circle_radius_texture_map()
-	, octastar_radius_texture_map()
-	, octagon_radius_texture_map()
+	, text_key()
+	, sprite_list()
+	, wheel_y(0)
+	, key_pressed_set()
+	, bitmap_texture(nullptr)
+	, bitmap_width(0)
+	, bitmap_height(0)
+	, point_buf()
+	, vertex_buf()
+	, index_buf()
+	, scene_texture(nullptr)
+	, scene_width(0)
+	, scene_height(0)
+	, scene_scale(1.)
+	, soft(false)
+	, raster()
+	, soft_texture(nullptr)
+	, text_mask_map()
+	, bitmap_mask()
 	{
 		SDL_Init(SDL_INIT_VIDEO);
 		SDL_SetEventFilter(event_filter, this);
@@ -42,72 +62,97 @@ struct screen_sdl_t
 		assert(renderer != nullptr);
 		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
 		TTF_Init();
+		sprite_list_make();
 		SDL_RenderClear(renderer);
 	}
 
-	~screen_sdl_t()
+	~screen_sdl_t() override
 	{
 		for (auto const& twh : text_texture_map)
 			SDL_DestroyTexture(twh.second.texture);
-		for (auto texture : circle_radius_texture_map)
-			if (texture != nullptr)
-				SDL_DestroyTexture(texture);
-		for (auto texture : octastar_radius_texture_map)
-			if (texture != nullptr)
-				SDL_DestroyTexture(texture);
-		for (auto texture : octagon_radius_texture_map)
-			if (texture != nullptr)
-				SDL_DestroyTexture(texture);
+		for (auto& level_list : sprite_list)
+			for (auto texture : level_list)
+				if (texture != nullptr)
+					SDL_DestroyTexture(texture);
+		if (bitmap_texture != nullptr)
+			SDL_DestroyTexture(bitmap_texture);
+		if (scene_texture != nullptr)
+			SDL_DestroyTexture(scene_texture);
+		if (soft_texture != nullptr)
+			SDL_DestroyTexture(soft_texture);
 		SDL_DestroyRenderer(renderer);
 		SDL_DestroyWindow(window);
 		SDL_Quit();
 	}
 
-	void window_title(const char* title)
+	// renderer=soft: draw calls go to raster_soft_t, present() uploads its frame
+	// to one streaming texture, the tiles run on job_system (the game's pool)
+	void soft_start(job_system_t& job_system)
 	{
-		SDL_SetWindowTitle(window, title);
+		texture_cnt++;
+		soft_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+			SDL_TEXTUREACCESS_STREAMING, width, height);
+		assert(soft_texture);
+		raster.start(width, height, job_system);
+		soft = true;
 	}
 
-	void clear()
+	void window_title(const char* title)
 	{
-		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
-		SDL_RenderClear(renderer);
+		SDL_SetWindowTitle(window, title);
 	}
 
-	struct color_t
+	// draw calls until scene_end() go to an off-screen texture of render_scale * window size
+	// coordinates stay in window pixels, SDL scales them down
+	void scene_begin(float render_scale) override
 	{
-		color_t()
-		: r(0)
-		, g(0)
-		, b(0)
-		{
-		}
-
-		color_t(uint8_t r_, uint8_t g_, uint8_t b_)
-		: r(r_)
-		, g(g_)
-		, b(b_)
+		scene_scale = soft ? 1. : render_scale;
+		if (scene_scale >= 1.)
+			return;
+		const coordinate_t scene_width_ = std::max<coordinate_t>(width * scene_scale, 1);
+		const coordinate_t scene_height_ = std::max<coordinate_t>(height * scene_scale, 1);
+		if (scene_texture == nullptr || scene_width != scene_width_ || scene_height != scene_height_)
 		{
+			if (scene_texture != nullptr)
+				SDL_DestroyTexture(scene_texture);
+			texture_cnt++;
+			scene_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+				SDL_TEXTUREACCESS_TARGET, scene_width_, scene_height_);
+			assert(scene_texture);
+			SDL_SetTextureScaleMode(scene_texture, SDL_ScaleModeLinear);
+			scene_width = scene_width_;
+			scene_height = scene_height_;
+			SDL_SetRenderTarget(renderer, scene_texture);
+			clear();
 		}
+		SDL_SetRenderTarget(renderer, scene_texture);
+		SDL_RenderSetScale(renderer, 1.f * scene_width / width, 1.f * scene_height / height);
+	}
 
-		bool operator == (const color_t& other) const
-		{
-			return (
-				r == other.r &&
-				g == other.g &&
-				b == other.b
-				);
-		}
+	// upscale the scene to the window, following draw calls are at window resolution
+	void scene_end() override
+	{
+		if (scene_scale >= 1.)
+			return;
+		SDL_SetRenderTarget(renderer, nullptr);
+		SDL_RenderCopy(renderer, scene_texture, nullptr, nullptr);
+	}
 
-		bool operator != (const color_t& other) const
+	void clear() override
+	{
+		if (soft)
 		{
-			return ! (*this == other);
+			raster.clear(raster_soft_t::color_make(0, 0, 0));
+			return;
 		}
+		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+		SDL_RenderClear(renderer);
+	}
 
-		uint8_t r;
-		uint8_t g;
-		uint8_t b;
-	};
+	static raster_soft_t::pixel_t pixel(screen_sdl_t::color_t color)
+	{
+		return raster_soft_t::color_make(color.r, color.g, color.b);
+	}
 
 	void plot(coordinate_t x, coordinate_t y, screen_sdl_t::color_t color)
 	{
@@ -119,90 +164,147 @@ struct screen_sdl_t
 		SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, 255);
 		coordinate_t x_sdl = x;
 		coordinate_t y_sdl = (height - y) / 2;
-		SDL_RenderDrawLine(renderer, x_sdl, y_sdl, x_prev, y_prev);
+		if (soft)
+			raster.line(xy_t{x_sdl, y_sdl}, xy_t{x_prev, y_prev}, pixel(color));
+		else
+			SDL_RenderDrawLine(renderer, x_sdl, y_sdl, x_prev, y_prev);
 		x_prev = x_sdl;
 		y_prev = y_sdl;
 		color_prev = color;
 	}
 
-	void point(coordinate_t x, coordinate_t y, screen_sdl_t::color_t color)
+	void point(coordinate_t x, coordinate_t y, screen_sdl_t::color_t color) override
 	{
+		if (soft)
+		{
+			raster.point(xy_t{x, y}, pixel(color));
+			return;
+		}
 		SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, 255);
 		SDL_RenderDrawPoint(renderer, x, y);
 	}
 
-	void line(coordinate_t x, coordinate_t y, coordinate_t x1, coordinate_t y1, screen_sdl_t::color_t color)
+	void line(coordinate_t x, coordinate_t y, coordinate_t x1, coordinate_t y1, screen_sdl_t::color_t color) override
 	{
+		if (soft)
+		{
+			raster.line(xy_t{x, y}, xy_t{x1, y1}, pixel(color));
+			return;
+		}
 		SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, 255);
 		SDL_RenderDrawLine(renderer, x, y, x1, y1);
 	}
 
-	void rect(coordinate_t x, coordinate_t y, coordinate_t x1, coordinate_t y1, screen_sdl_t::color_t color)
+	// connected line through all points
+	void lines(const xy_t* xy_list, size_t count, screen_sdl_t::color_t color) override
 	{
+		if (soft)
+		{
+			for (size_t idx = 1; idx < count; ++idx)
+				raster.line(xy_list[idx - 1], xy_list[idx], pixel(color));
+			return;
+		}
+		point_buf.resize(count);
+		for (size_t idx = 0; idx < count; ++idx)
+			point_buf[idx] = SDL_Point{xy_list[idx].x, xy_list[idx].y};
 		SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, 255);
-		const int width = x1 - x;
-		const int height = y1 - y;
-		const SDL_Rect rect{x, y, width, height};
-		SDL_RenderDrawRect(renderer, &rect);
+		SDL_RenderDrawLines(renderer, point_buf.data(), point_buf.size());
 	}
 
-	void circle(coordinate_t x, coordinate_t y, coordinate_t radius, screen_sdl_t::color_t color)
+	// filled band of half width radius along the line, one SDL_RenderGeometry call
+	void ribbon(const xy_t* xy_list, size_t count, float radius, screen_sdl_t::color_t color) override
 	{
-		coordinate_t width_tmp = radius * 2 + 2;
-		coordinate_t height_tmp = radius * 2 + 2;
-		SDL_Rect rect = {x - width_tmp/2, y - height_tmp/2, width_tmp, height_tmp};
-		SDL_Texture* texture = nullptr;
-		if (circle_radius_texture_map[radius] != nullptr)
+		if (count < 2)
+			return;
+		const SDL_Color sdl_color{color.r, color.g, color.b, 255};
+		vertex_buf.clear();
+		index_buf.clear();
+		float nx = 0.;
+		float ny = radius;
+		for (size_t idx = 0; idx < count; ++idx)
 		{
-			texture = circle_radius_texture_map[radius];
-			SDL_SetTextureColorMod(texture, color.r, color.g, color.b);
-			SDL_RenderCopy(renderer, texture, nullptr, &rect);
+			const xy_t& xy = xy_list[idx];
+			const xy_t& prev = xy_list[idx == 0 ? idx : idx - 1];
+			const xy_t& next = xy_list[idx + 1 == count ? idx : idx + 1];
+			const float tx = next.x - prev.x;
+			const float ty = next.y - prev.y;
+			const float len = ::sqrtf(tx * tx + ty * ty);
+			if (len > 0.)
+			{
+				nx = -ty / len * radius;
+				ny = tx / len * radius;
+			}
+			vertex_buf.push_back(SDL_Vertex{SDL_FPoint{xy.x + nx, xy.y + ny}, sdl_color, SDL_FPoint{0., 0.}});
+			vertex_buf.push_back(SDL_Vertex{SDL_FPoint{xy.x - nx, xy.y - ny}, sdl_color, SDL_FPoint{0., 0.}});
+		}
+		if (soft)
+		{
+			const raster_soft_t::pixel_t soft_color = pixel(color);
+			for (size_t idx = 0; idx + 3 < vertex_buf.size(); idx += 2)
+			{
+				const SDL_FPoint& v0 = vertex_buf[idx].position;
+				const SDL_FPoint& v1 = vertex_buf[idx + 1].position;
+				const SDL_FPoint& v2 = vertex_buf[idx + 2].position;
+				const SDL_FPoint& v3 = vertex_buf[idx + 3].position;
+				raster.triangle(v0.x, v0.y, v1.x, v1.y, v2.x, v2.y, soft_color);
+				raster.triangle(v1.x, v1.y, v3.x, v3.y, v2.x, v2.y, soft_color);
+			}
 			return;
 		}
-
-		SDL_Surface* surface = SDL_CreateRGBSurface(
-			SDL_SWSURFACE,
-			width_tmp, height_tmp,
-			32, 0, 0, 0, 0);
-		assert(surface);
-		SDL_SetColorKey(surface, SDL_TRUE, SDL_MapRGB(surface->format, 0, 0, 0));
-		SDL_Renderer* renderer_sw = SDL_CreateSoftwareRenderer(surface);
-		assert(renderer_sw);
-		SDL_SetRenderDrawColor(renderer_sw, 0, 0, 0, 0);
-		SDL_RenderClear(renderer_sw);
-
-		size_t circle_len = 2 * M_PI * radius;
-		float angle_step = 2 * M_PI / circle_len;
-		SDL_SetRenderDrawColor(renderer_sw, 255, 255, 255, 255);
-		for (size_t cnt = 0; cnt < circle_len; ++cnt)
+		for (int idx = 0; idx + 3 < static_cast<int>(vertex_buf.size()); idx += 2)
 		{
-			xy_t xy{radius, 0};
-			float angle = angle_step * cnt;
-			xy = xy_rot(xy, xy_t{width_tmp/2, width_tmp/2}, angle);
-			SDL_RenderDrawPoint(renderer_sw, xy.x, xy.y);
+			const int quad[] = {idx, idx + 1, idx + 2, idx + 1, idx + 3, idx + 2};
+			index_buf.insert(index_buf.end(), std::begin(quad), std::end(quad));
 		}
-		texture = SDL_CreateTextureFromSurface(renderer, surface);
-		SDL_DestroyRenderer(renderer_sw);
-		SDL_FreeSurface(surface);
-		circle_radius_texture_map[radius] = texture;
-		SDL_SetTextureColorMod(texture, color.r, color.g, color.b);
-		SDL_RenderCopy(renderer, texture, nullptr, &rect);
+		SDL_RenderGeometry(renderer, nullptr,
+			vertex_buf.data(), vertex_buf.size(), index_buf.data(), index_buf.size());
 	}
 
-	void octastar(coordinate_t x, coordinate_t y, coordinate_t radius, screen_sdl_t::color_t color)
+	void rect(coordinate_t x, coordinate_t y, coordinate_t x1, coordinate_t y1, screen_sdl_t::color_t color) override
 	{
-		coordinate_t width_tmp = radius * 2 + 2;
-		coordinate_t height_tmp = radius * 2 + 2;
-		SDL_Rect rect = {x - width_tmp/2, y - height_tmp/2, width_tmp, height_tmp};
-		SDL_Texture* texture = nullptr;
-		if (octastar_radius_texture_map[radius] != nullptr)
+		if (soft)
 		{
-			texture = octastar_radius_texture_map[radius];
-			SDL_SetTextureColorMod(texture, color.r, color.g, color.b);
-			SDL_RenderCopy(renderer, texture, nullptr, &rect);
+			raster.line(xy_t{x, y}, xy_t{x1 - 1, y}, pixel(color));
+			raster.line(xy_t{x1 - 1, y}, xy_t{x1 - 1, y1 - 1}, pixel(color));
+			raster.line(xy_t{x1 - 1, y1 - 1}, xy_t{x, y1 - 1}, pixel(color));
+			raster.line(xy_t{x, y1 - 1}, xy_t{x, y}, pixel(color));
 			return;
 		}
+		SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, 255);
+		const int width = x1 - x;
+		const int height = y1 - y;
+		const SDL_Rect rect{x, y, width, height};
+		SDL_RenderDrawRect(renderer, &rect);
+	}
+
+	enum sprite_t
+	{
+		sprite_circle,
+		sprite_octastar,
+		sprite_octagon,
+		sprite_count
+	};
 
+	// each shape is made once per radius 2, 4 ... 256 and scaled down on the GPU
+	// from the next larger one, so zooming creates no textures
+	static const size_t sprite_level_count = 8;
+
+	static coordinate_t sprite_level_radius(size_t level)
+	{
+		return coordinate_t(2) << level;
+	}
+
+	void sprite_list_make()
+	{
+		for (size_t sprite = 0; sprite < sprite_count; ++sprite)
+			for (size_t level = 0; level < sprite_level_count; ++level)
+				sprite_list[sprite][level] = sprite_make(static_cast<sprite_t>(sprite), sprite_level_radius(level));
+	}
+
+	SDL_Texture* sprite_make(sprite_t sprite, coordinate_t radius)
+	{
+		coordinate_t width_tmp = radius * 2 + 2;
+		coordinate_t height_tmp = radius * 2 + 2;
 		SDL_Surface* surface = SDL_CreateRGBSurface(
 			SDL_SWSURFACE,
 			width_tmp, height_tmp,
@@ -214,72 +316,114 @@ struct screen_sdl_t
 		SDL_SetRenderDrawColor(renderer_sw, 0, 0, 0, 0);
 		SDL_RenderClear(renderer_sw);
 		SDL_SetRenderDrawColor(renderer_sw, 255, 255, 255, 255);
-		octagon_t oct = make_octastar(width_tmp/2, width_tmp/2, radius);
-		SDL_RenderDrawLine(renderer_sw,width_tmp/2, width_tmp/2, oct[0].x, oct[0].y);
-		SDL_RenderDrawLine(renderer_sw,width_tmp/2, width_tmp/2, oct[1].x, oct[1].y);
-		SDL_RenderDrawLine(renderer_sw,width_tmp/2, width_tmp/2, oct[2].x, oct[2].y);
-		SDL_RenderDrawLine(renderer_sw,width_tmp/2, width_tmp/2, oct[3].x, oct[3].y);
-		SDL_RenderDrawLine(renderer_sw,width_tmp/2, width_tmp/2, oct[4].x, oct[4].y);
-		SDL_RenderDrawLine(renderer_sw,width_tmp/2, width_tmp/2, oct[5].x, oct[5].y);
-		SDL_RenderDrawLine(renderer_sw,width_tmp/2, width_tmp/2, oct[6].x, oct[6].y);
-		SDL_RenderDrawLine(renderer_sw,width_tmp/2, width_tmp/2, oct[7].x, oct[7].y);
-		texture = SDL_CreateTextureFromSurface(renderer, surface);
+		switch (sprite)
+		{
+			case sprite_circle:
+			{
+				size_t circle_len = 2 * M_PI * radius;
+				float angle_step = 2 * M_PI / circle_len;
+				std::vector<xy_t> xy_list(circle_len, xy_t{radius, 0});
+				std::vector<float> angle_list(circle_len);
+				for (size_t cnt = 0; cnt < circle_len; ++cnt)
+					angle_list[cnt] = angle_step * cnt;
+				xy_rot_batch(xy_list.data(), angle_list.data(), circle_len,
+					xy_t{width_tmp/2, width_tmp/2}, xy_list.data(), trig_fast);
+				point_buf.resize(circle_len);
+				for (size_t cnt = 0; cnt < circle_len; ++cnt)
+					point_buf[cnt] = SDL_Point{xy_list[cnt].x, xy_list[cnt].y};
+				SDL_RenderDrawPoints(renderer_sw, point_buf.data(), point_buf.size());
+				break;
+			}
+			case sprite_octastar:
+			{
+				octagon_t oct = make_octastar(width_tmp/2, width_tmp/2, radius);
+				for (const xy_t& xy : oct)
+					SDL_RenderDrawLine(renderer_sw, width_tmp/2, width_tmp/2, xy.x, xy.y);
+				break;
+			}
+			case sprite_octagon:
+			{
+				octagon_t oct = make_octagon(width_tmp/2, width_tmp/2, radius);
+				for (size_t cnt = 0; cnt < oct.size(); ++cnt)
+				{
+					const xy_t& xy = oct[cnt];
+					const xy_t& next = oct[(cnt + 1) % oct.size()];
+					SDL_RenderDrawLine(renderer_sw, xy.x, xy.y, next.x, next.y);
+				}
+				break;
+			}
+			default:
+				break;
+		}
+		texture_cnt++;
+		SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+		assert(texture);
+		SDL_SetTextureScaleMode(texture, SDL_ScaleModeLinear);
 		SDL_DestroyRenderer(renderer_sw);
 		SDL_FreeSurface(surface);
-		octastar_radius_texture_map[radius] = texture;
-		SDL_SetTextureColorMod(texture, color.r, color.g, color.b);
-		SDL_RenderCopy(renderer, texture, nullptr, &rect);
+		return texture;
 	}
 
-	void octagon(coordinate_t x, coordinate_t y, coordinate_t radius, screen_sdl_t::color_t color)
+	void sprite(sprite_t sprite, coordinate_t x, coordinate_t y, coordinate_t radius, screen_sdl_t::color_t color)
 	{
-		coordinate_t width_tmp = radius * 2 + 2;
-		coordinate_t height_tmp = radius * 2 + 2;
-		SDL_Rect rect = {x - width_tmp/2, y - height_tmp/2, width_tmp, height_tmp};
-		SDL_Texture* texture = nullptr;
-		if (octagon_radius_texture_map[radius] != nullptr)
+		if (soft)
 		{
-			texture = octagon_radius_texture_map[radius];
-			SDL_SetTextureColorMod(texture, color.r, color.g, color.b);
-			SDL_RenderCopy(renderer, texture, nullptr, &rect);
+			switch (sprite)
+			{
+				case sprite_circle: raster.circle(xy_t{x, y}, radius, pixel(color)); break;
+				case sprite_octastar: raster.octastar(xy_t{x, y}, radius, pixel(color)); break;
+				case sprite_octagon: raster.octagon(xy_t{x, y}, radius, pixel(color)); break;
+				default: break;
+			}
 			return;
 		}
-
-		SDL_Surface* surface = SDL_CreateRGBSurface(
-			SDL_SWSURFACE,
-			width_tmp, height_tmp,
-			32, 0, 0, 0, 0);
-		assert(surface);
-		SDL_SetColorKey(surface, SDL_TRUE, SDL_MapRGB(surface->format, 0, 0, 0));
-		SDL_Renderer* renderer_sw = SDL_CreateSoftwareRenderer(surface);
-		assert(renderer_sw);
-		SDL_SetRenderDrawColor(renderer_sw, 0, 0, 0, 0);
-		SDL_RenderClear(renderer_sw);
-		SDL_SetRenderDrawColor(renderer_sw, 255, 255, 255, 255);
-		octagon_t oct = make_octagon(width_tmp/2, width_tmp/2, radius);
-		SDL_RenderDrawLine(renderer_sw, oct[0].x, oct[0].y, oct[1].x, oct[1].y);
-		SDL_RenderDrawLine(renderer_sw, oct[1].x, oct[1].y, oct[2].x, oct[2].y);
-		SDL_RenderDrawLine(renderer_sw, oct[2].x, oct[2].y, oct[3].x, oct[3].y);
-		SDL_RenderDrawLine(renderer_sw, oct[3].x, oct[3].y, oct[4].x, oct[4].y);
-		SDL_RenderDrawLine(renderer_sw, oct[4].x, oct[4].y, oct[5].x, oct[5].y);
-		SDL_RenderDrawLine(renderer_sw, oct[5].x, oct[5].y, oct[6].x, oct[6].y);
-		SDL_RenderDrawLine(renderer_sw, oct[6].x, oct[6].y, oct[7].x, oct[7].y);
-		SDL_RenderDrawLine(renderer_sw, oct[7].x, oct[7].y, oct[0].x, oct[0].y);
-		texture = SDL_CreateTextureFromSurface(renderer, surface);
-		SDL_DestroyRenderer(renderer_sw);
-		SDL_FreeSurface(surface);
-		octagon_radius_texture_map[radius] = texture;
+		size_t level = 0;
+		while (level + 1 < sprite_level_count && sprite_level_radius(level) < radius)
+			++level;
+		coordinate_t width_tmp = radius * 2 + 2;
+		coordinate_t height_tmp = radius * 2 + 2;
+		SDL_Rect rect = {x - width_tmp/2, y - height_tmp/2, width_tmp, height_tmp};
+		SDL_Texture* texture = sprite_list[sprite][level];
 		SDL_SetTextureColorMod(texture, color.r, color.g, color.b);
 		SDL_RenderCopy(renderer, texture, nullptr, &rect);
 	}
 
-	void text(coordinate_t x, coordinate_t y, screen_sdl_t::color_t color, coordinate_t size, const char* text)
+	void circle(coordinate_t x, coordinate_t y, coordinate_t radius, screen_sdl_t::color_t color) override
+	{
+		sprite(sprite_circle, x, y, radius, color);
+	}
+
+	void octastar(coordinate_t x, coordinate_t y, coordinate_t radius, screen_sdl_t::color_t color) override
+	{
+		sprite(sprite_octastar, x, y, radius, color);
+	}
+
+	void octagon(coordinate_t x, coordinate_t y, coordinate_t radius, screen_sdl_t::color_t color) override
+	{
+		sprite(sprite_octagon, x, y, radius, color);
+	}
+
+	static const size_t text_cache_max = 1024;  // rendered strings kept
+
+	size_t text_cache_size() const override
+	{
+		return text_texture_map.size() + text_mask_map.size();
+	}
+
+	void text(coordinate_t x, coordinate_t y, screen_sdl_t::color_t color, coordinate_t size, const char* text) override
 	{
 		assert(text);
 		static TTF_Font* font = TTF_OpenFont(font_path.c_str(), size);
 		assert(font);
-		std::string text_str = text;
-		auto it = text_texture_map.find(std::string(text_str));
+		// assign keeps the capacity, no heap allocation per call
+		std::string& text_str = text_key;
+		text_str = text;
+		if (soft)
+		{
+			text_soft(x, y, color, font, text_str);
+			return;
+		}
+		auto it = text_texture_map.find(text_str);
 		if (it != text_texture_map.end())
 		{
 			texture_width_height_t* twh = &it->second;
@@ -289,10 +433,18 @@ struct screen_sdl_t
 			return;
 		}
 
+		// HUD numbers change every frame, start over rather than grow without bound
+		if (text_texture_map.size() >= text_cache_max)
+		{
+			for (auto const& twh : text_texture_map)
+				SDL_DestroyTexture(twh.second.texture);
+			text_texture_map.clear();
+		}
 		SDL_Color textColor = { 255, 255, 255, 0 };
 		SDL_Surface* surface = TTF_RenderText_Solid(font, text, textColor);
 		assert(surface);
 		SDL_SetColorKey(surface, SDL_TRUE, SDL_MapRGB(surface->format, 0, 0, 0));
+		texture_cnt++;
 		SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
 		int text_width = surface->w;
 		int text_height = surface->h;
@@ -305,11 +457,111 @@ struct screen_sdl_t
 		text_texture_map.insert(std::make_pair(text_str, twh));
 	}
 
+	// mask from the 8 bit TTF_RenderText_Solid surface, colour index 0 is background
+	void text_soft(coordinate_t x, coordinate_t y, screen_sdl_t::color_t color, TTF_Font* font,
+		const std::string& text_str)
+	{
+		auto it = text_mask_map.find(text_str);
+		if (it == text_mask_map.end())
+		{
+			texture_cnt++;
+			SDL_Color textColor = { 255, 255, 255, 0 };
+			SDL_Surface* surface = TTF_RenderText_Solid(font, text_str.c_str(), textColor);
+			assert(surface);
+			text_mask_t text_mask{std::vector<uint8_t>(surface->w * surface->h), surface->w, surface->h};
+			for (coordinate_t row = 0; row < surface->h; ++row)
+			{
+				const uint8_t* src = static_cast<const uint8_t*>(surface->pixels) + row * surface->pitch;
+				for (coordinate_t col = 0; col < surface->w; ++col)
+					text_mask.mask[row * surface->w + col] = src[col] != 0;
+			}
+			SDL_FreeSurface(surface);
+			it = text_mask_map.insert(std::make_pair(text_str, std::move(text_mask))).first;
+		}
+		const text_mask_t& text_mask = it->second;
+		raster.blit(text_mask.mask.data(), text_mask.width, text_mask.height,
+			rect_t{xy_t{x, y}, xy_t{x + text_mask.width - 1, y + text_mask.height - 1}}, pixel(color));
+	}
+
+	// expand 1 bit per pixel bitmap (see bitmap.h) into the streaming bitmap texture
+	// call only when the bitmap changes, bitmap() draws the last uploaded one
+	void bitmap_update(const uint64_t* word_list, coordinate_t width_, coordinate_t height_) override
+	{
+		static const size_t word_bits = 64;
+		if (soft)
+		{
+			bitmap_mask.resize(width_ * height_);
+			for (size_t idx = 0; idx < bitmap_mask.size(); ++idx)
+				bitmap_mask[idx] = (word_list[idx / word_bits] >> (idx % word_bits)) & 1;
+			bitmap_width = width_;
+			bitmap_height = height_;
+			return;
+		}
+		if (bitmap_texture == nullptr || bitmap_width != width_ || bitmap_height != height_)
+		{
+			if (bitmap_texture != nullptr)
+				SDL_DestroyTexture(bitmap_texture);
+			texture_cnt++;
+			bitmap_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+				SDL_TEXTUREACCESS_STREAMING, width_, height_);
+			assert(bitmap_texture);
+			SDL_SetTextureBlendMode(bitmap_texture, SDL_BLENDMODE_BLEND);
+			bitmap_width = width_;
+			bitmap_height = height_;
+		}
+
+		void* pixels = nullptr;
+		int pitch = 0;
+		if (SDL_LockTexture(bitmap_texture, nullptr, &pixels, &pitch) != 0)
+		{
+			ERR("SDL_LockTexture() failed: %s", SDL_GetError());
+			return;
+		}
+		for (coordinate_t y = 0; y < height_; ++y)
+		{
+			uint32_t* row = reinterpret_cast<uint32_t*>(static_cast<uint8_t*>(pixels) + y * pitch);
+			for (coordinate_t x = 0; x < width_; )
+			{
+				const size_t idx = y * width_ + x;
+				const size_t shift = idx % word_bits;
+				const coordinate_t run = std::min<coordinate_t>(word_bits - shift, width_ - x);
+				const uint64_t word = word_list[idx / word_bits] >> shift;
+				if (word == 0)
+					memset(row + x, 0, run * sizeof(*row));
+				else
+					for (coordinate_t bit = 0; bit < run; ++bit)
+						row[x + bit] = ((word >> bit) & 1) ? 0xffffffff : 0;
+				x += run;
+			}
+		}
+		SDL_UnlockTexture(bitmap_texture);
+	}
+
+	void bitmap(coordinate_t x, coordinate_t y, float scale, screen_sdl_t::color_t color) override
+	{
+		if (soft)
+		{
+			const coordinate_t bitmap_width_scaled = bitmap_width * scale;
+			const coordinate_t bitmap_height_scaled = bitmap_height * scale;
+			raster.blit(bitmap_mask.data(), bitmap_width, bitmap_height,
+				rect_t{xy_t{x, y}, xy_t{x + bitmap_width_scaled - 1, y + bitmap_height_scaled - 1}},
+				pixel(color));
+			return;
+		}
+		if (bitmap_texture == nullptr)
+			return;
+		SDL_Rect rect = {x, y,
+			static_cast<coordinate_t>(bitmap_width * scale),
+			static_cast<coordinate_t>(bitmap_height * scale)};
+		SDL_SetTextureColorMod(bitmap_texture, color.r, color.g, color.b);
+		SDL_RenderCopy(renderer, bitmap_texture, nullptr, &rect);
+	}
+
 	void window_position(coordinate_t& x, coordinate_t& y)
 	{
 		SDL_GetWindowPosition(window, &x, &y);
 	}
-	bool mouse_position(coordinate_t& x, coordinate_t& y)
+	bool mouse_position(coordinate_t& x, coordinate_t& y) override
 	{
 		SDL_PumpEvents();
 		SDL_GetMouseState(&x,&y);
@@ -327,13 +579,31 @@ struct screen_sdl_t
 		return true;
 	}
 
-	bool mouse_button_left()
+	// wheel steps since the last call, positive away from the user
+	int mouse_wheel() override
+	{
+		SDL_PumpEvents();
+		int steps = wheel_y;
+		wheel_y = 0;
+		return steps;
+	}
+
+	bool mouse_button_left() override
 	{
 		SDL_PumpEvents();
 		uint32_t button_mask = SDL_GetMouseState(NULL, NULL);
 		return button_mask & SDL_BUTTON(SDL_BUTTON_LEFT);
 	}
 
+	bool key_pressed(int key) override
+	{
+		SDL_PumpEvents();
+		if (key < 0 || key >= static_cast<int>(key_pressed_set.size()) || !key_pressed_set[key])
+			return false;
+		key_pressed_set[key] = false;
+		return true;
+	}
+
 	static int event_filter(void* userdata,  SDL_Event* event)
     {
 		screen_sdl_t* thiz = reinterpret_cast<screen_sdl_t*>(userdata);
@@ -342,11 +612,27 @@ struct screen_sdl_t
 		if (event->type == SDL_KEYDOWN &&
 			event->key.keysym.sym == SDLK_ESCAPE)
 			thiz->quit = true;
+		if (event->type == SDL_KEYDOWN && !event->key.repeat &&
+			event->key.keysym.sym >= 0 && event->key.keysym.sym < static_cast<int>(thiz->key_pressed_set.size()))
+			thiz->key_pressed_set[event->key.keysym.sym] = true;
+		if (event->type == SDL_MOUSEWHEEL)
+			thiz->wheel_y += event->wheel.direction == SDL_MOUSEWHEEL_FLIPPED ? -event->wheel.y : event->wheel.y;
 		return 1; // add event to SDL event queue
 	}
 
-	void present()
+	void present() override
 	{
+		if (soft)
+		{
+			raster.flush();
+			// blit() keeps mask pointers until flush(), evict only after it
+			if (text_mask_map.size() >= text_cache_max)
+				text_mask_map.clear();
+			SDL_UpdateTexture(soft_texture, nullptr, raster.frame.data(),
+				width * sizeof(raster_soft_t::pixel_t));
+			SDL_RenderCopy(renderer, soft_texture, nullptr, nullptr);
+		}
+		TRACE_SCOPE("SDL_RenderPresent");
 		SDL_RenderPresent(renderer);
 	}
 
@@ -391,8 +677,6 @@ struct screen_sdl_t
 		LOG("event.type:%d", event.type);
 	}
 
-	coordinate_t width;
-	coordinate_t height;
 	SDL_Window *window;
 	SDL_Renderer *renderer;
 	SDL_Event event;
@@ -408,9 +692,31 @@ struct screen_sdl_t
 		coordinate_t height;
 	};
 	std::unordered_map<std::string, texture_width_height_t> text_texture_map;
-	std::array<SDL_Texture*, 1024> circle_radius_texture_map;
-	std::array<SDL_Texture*, 1024> octastar_radius_texture_map;
-	std::array<SDL_Texture*, 1024> octagon_radius_texture_map;
+	std::string text_key;  // text() argument, reused
+	std::array<std::array<SDL_Texture*, sprite_level_count>, sprite_count> sprite_list;
+	int wheel_y;
+	std::bitset<128> key_pressed_set;  // ASCII keys pressed since key_pressed() asked for them
+	SDL_Texture* bitmap_texture;
+	coordinate_t bitmap_width;
+	coordinate_t bitmap_height;
+	std::vector<SDL_Point> point_buf;
+	std::vector<SDL_Vertex> vertex_buf;
+	std::vector<int> index_buf;
+	SDL_Texture* scene_texture;
+	coordinate_t scene_width;
+	coordinate_t scene_height;
+	float scene_scale;
+	bool soft;
+	raster_soft_t raster;
+	SDL_Texture* soft_texture;
+	struct text_mask_t
+	{
+		std::vector<uint8_t> mask;
+		coordinate_t width;
+		coordinate_t height;
+	};
+	std::unordered_map<std::string, text_mask_t> text_mask_map;
+	std::vector<uint8_t> bitmap_mask;
 };
 
 #endif  // SCREEN_SDL_H
@@ -0,0 +1,532 @@
+#include "geometry.h"
+#include "geometry_batch.h"
+#include "fast_trig.h"
+#include "kinematics.h"
+#include "game.h"
+#include "game_rec.h"
+#include "screen_null.h"
+#include "alloc.h"
+#include "trace.h"
+#include "clock.h"
+#include "log.h"
+#include "util.h"
+
+#include <cstdlib>
+#include <cmath>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Microbenchmarks of the hot path helpers, scalar against batch versions.
+// ./slithercc_bench [count=1024] [repeat=100] [play_file=game.rec] [trace_file=bench.json]
+//	[alloc_draw_max=N] [alloc_pkt_max=N]
+// play_file also decodes and draws a record_file recording headless, as fast as it goes,
+// trace_file is the timeline of that replay. The replay is then run once more counting
+// heap allocations, the run fails when the steady state allocations per draw or per
+// packet exceed the alloc_*_max budgets.
+
+static const coordinate_t game_field_size = 21600 * 2;
+static const coordinate_t snake_step = 42;
+
+struct config_t
+{
+	size_t count;
+	size_t repeat;
+	std::string play_file;
+	std::string trace_file;
+	double alloc_draw_max;  // < 0 - no budget
+	double alloc_pkt_max;
+};
+
+config_t parse_opts(int argc, const char* argv[])
+{
+	config_t config{};
+	config.count = 1024;
+	config.repeat = 100;
+	config.alloc_draw_max = -1;
+	config.alloc_pkt_max = -1;
+	for (ssize_t idx = 1; idx < argc; ++idx)
+	{
+		std::string opt = argv[idx];
+		if (!opt.find('='))
+			continue;
+		key_val_t key_val = key_val_split(opt, "=");
+		if (key_val.key == "count")
+			config.count = strtoul(key_val.val.c_str(), NULL, 10);
+		else if (key_val.key == "repeat")
+			config.repeat = strtoul(key_val.val.c_str(), NULL, 10);
+		else if (key_val.key == "play_file")
+			config.play_file = key_val.val;
+		else if (key_val.key == "trace_file")
+			config.trace_file = key_val.val;
+		else if (key_val.key == "alloc_draw_max")
+			config.alloc_draw_max = strtod(key_val.val.c_str(), NULL);
+		else if (key_val.key == "alloc_pkt_max")
+			config.alloc_pkt_max = strtod(key_val.val.c_str(), NULL);
+	}
+	return config;
+}
+
+// keeps results alive so the compiler does not drop the benchmarked loops
+static volatile int64_t bench_sink;
+
+template <typename Tfunc>
+static void bench_run(const char* name, const config_t& config, Tfunc func)
+{
+	func();  // warm up
+	uint64_t start_us = uptime_us();
+	for (size_t cnt = 0; cnt < config.repeat; ++cnt)
+		func();
+	uint64_t time_us = uptime_us() - start_us;
+	printf("%-32s %8.2f ns/op\n", name, 1000. * time_us / (config.repeat * config.count));
+}
+
+static void bench_geometry(const config_t& config)
+{
+	const coordinate_t field = game_field_size;
+	std::vector<xy_t> xy1(config.count);
+	std::vector<xy_t> xy2(config.count);
+	std::vector<float> ang(config.count);
+	for (size_t idx = 0; idx < config.count; ++idx)
+	{
+		xy1[idx] = xy_t{rand() % field, rand() % field};
+		xy2[idx] = xy_t{rand() % field, rand() % field};
+		ang[idx] = (rand() % 62832) / 10000.;
+	}
+	std::vector<xy_t> xy_out(config.count);
+	std::vector<coordinate_t> dist_out(config.count);
+	std::vector<float> float_out(config.count);
+	std::vector<float> float_out2(config.count);
+	std::vector<uint32_t> idx_out(config.count);
+	const xy_t center{field / 2, field / 2};
+
+	bench_run("distance", config, [&]()
+		{
+			for (size_t idx = 0; idx < config.count; ++idx)
+				dist_out[idx] = distance(xy1[idx], xy2[idx]);
+			bench_sink += dist_out[config.count / 2];
+		});
+	bench_run("distance_batch", config, [&]()
+		{
+			distance_batch(xy1.data(), xy2.data(), config.count, dist_out.data());
+			bench_sink += dist_out[config.count / 2];
+		});
+
+	bench_run("xy_angle", config, [&]()
+		{
+			for (size_t idx = 0; idx < config.count; ++idx)
+				float_out[idx] = xy_angle(xy1[idx], xy2[idx]);
+			bench_sink += float_out[config.count / 2];
+		});
+	bench_run("xy_angle_batch libm", config, [&]()
+		{
+			xy_angle_batch(xy1.data(), xy2.data(), config.count, float_out.data(), trig_libm);
+			bench_sink += float_out[config.count / 2];
+		});
+	bench_run("xy_angle_batch fast", config, [&]()
+		{
+			xy_angle_batch(xy1.data(), xy2.data(), config.count, float_out.data(), trig_fast);
+			bench_sink += float_out[config.count / 2];
+		});
+
+	bench_run("xy_rot", config, [&]()
+		{
+			for (size_t idx = 0; idx < config.count; ++idx)
+				xy_out[idx] = xy_rot(xy1[idx], center, ang[idx]);
+			bench_sink += xy_out[config.count / 2].x;
+		});
+	bench_run("xy_rot_batch fast", config, [&]()
+		{
+			xy_rot_batch(xy1.data(), ang.data(), config.count, center, xy_out.data(), trig_fast);
+			bench_sink += xy_out[config.count / 2].x;
+		});
+
+	// same input and the same copy for both, the batch version works in place
+	std::vector<float> ang_shift(config.count);
+	for (size_t idx = 0; idx < config.count; ++idx)
+		ang_shift[idx] = ang[idx] - 3.;
+	bench_run("norm_angle", config, [&]()
+		{
+			float_out = ang_shift;
+			for (size_t idx = 0; idx < config.count; ++idx)
+				float_out[idx] = norm_angle(float_out[idx]);
+			bench_sink += float_out[config.count / 2];
+		});
+	bench_run("norm_angle_batch", config, [&]()
+		{
+			float_out = ang_shift;
+			norm_angle_batch(float_out.data(), config.count);
+			bench_sink += float_out[config.count / 2];
+		});
+
+	bench_run("sincos_batch libm", config, [&]()
+		{
+			sincos_batch(ang.data(), config.count, float_out.data(), float_out2.data(), trig_libm);
+			bench_sink += float_out[config.count / 2];
+		});
+	bench_run("sincos_batch fast", config, [&]()
+		{
+			sincos_batch(ang.data(), config.count, float_out.data(), float_out2.data(), trig_fast);
+			bench_sink += float_out[config.count / 2];
+		});
+
+	const xy_transform_t xform{center, 0.5, xy_t{960, 540}};
+	const rect_t screen_rect{xy_t{0, 0}, xy_t{1920, 1080}};
+	bench_run("screen_xy", config, [&]()
+		{
+			for (size_t idx = 0; idx < config.count; ++idx)
+			{
+				xy_t xy{(xy1[idx].x - center.x) * xform.scale, (xy1[idx].y - center.y) * xform.scale};
+				xy.x += xform.offset.x;
+				xy.y += xform.offset.y;
+				xy_out[idx] = xy;
+			}
+			bench_sink += xy_out[config.count / 2].x;
+		});
+	bench_run("xy_transform", config, [&]()
+		{
+			xy_transform(xform, xy1.data(), config.count, xy_out.data());
+			bench_sink += xy_out[config.count / 2].x;
+		});
+	bench_run("xy_transform_cull", config, [&]()
+		{
+			bench_sink += xy_transform_cull(xform, screen_rect,
+				xy1.data(), config.count, xy_out.data(), idx_out.data());
+		});
+}
+
+static void bench_kinematics(const config_t& config)
+{
+	const coordinate_t field = game_field_size;
+	kinematics_t kinematics;
+	const uint64_t now_us = uptime_us();
+	for (size_t idx = 0; idx < config.count; ++idx)
+	{
+		kinematics.add(xy_t{rand() % field, rand() % field}, (rand() % 62832) / 10000.,
+			(rand() % 3 - 1) * 1.4e-6, rand() % 400, now_us - rand() % 100000);
+	}
+	std::vector<xy_t> xy_out(config.count);
+
+	bench_run("extrapolate cosf/sinf", config, [&]()
+		{
+			for (size_t idx = 0; idx < config.count; ++idx)
+			{
+				const float dt = now_us - kinematics.tstamp_us[idx];
+				const float angle = norm_angle(kinematics.heading[idx] + kinematics.turn_rate[idx] * dt);
+				const coordinate_t dist = kinematics.speed[idx] * dt / 1000000.;
+				xy_t xy{kinematics.x[idx], kinematics.y[idx]};
+				xy.x += ::cosf(angle) * dist;
+				xy.y += ::sinf(angle) * dist;
+				xy_out[idx] = xy;
+			}
+			bench_sink += xy_out[config.count / 2].x;
+		});
+	bench_run("kinematics_t::extrapolate", config, [&]()
+		{
+			kinematics.extrapolate(now_us);
+			bench_sink += kinematics.xy_out[config.count / 2].x;
+		});
+}
+
+// snake body smoothing on whole unit and fixed point coordinates
+// drift is the mean distance of the parts from a double precision body fed with the same heads
+template <typename T>
+static std::deque<basic_xy_t<T>> squeeze_run(const std::vector<xy_t>& head_list, size_t length)
+{
+	static const float cst = 0.43;
+	std::deque<basic_xy_t<T>> part_list;
+	for (const xy_t& head : head_list)
+	{
+		part_list.push_front(basic_xy_t<T>{T(head.x), T(head.y)});
+		if (part_list.size() >= 4)
+			xy_list_squeeze<T>(part_list, 3, cst);
+		if (part_list.size() > length)
+			part_list.pop_back();
+	}
+	return part_list;
+}
+
+template <typename T>
+static double squeeze_drift(const std::deque<basic_xy_t<T>>& part_list, const std::deque<basic_xy_t<double>>& ref)
+{
+	double sum = 0.;
+	for (size_t idx = 0; idx < ref.size(); ++idx)
+	{
+		const double dx = static_cast<double>(coordinate_int(part_list[idx].x)) - ref[idx].x;
+		const double dy = static_cast<double>(coordinate_int(part_list[idx].y)) - ref[idx].y;
+		sum += std::sqrt(dx * dx + dy * dy);
+	}
+	return sum / ref.size();
+}
+
+static void bench_squeeze(const config_t& config)
+{
+	const size_t length = 400;
+	std::vector<xy_t> head_list(config.count);
+	xy_t head{game_field_size / 2, game_field_size / 2};
+	float angle = 0.;
+	for (xy_t& xy : head_list)
+	{
+		angle += (rand() % 2001 - 1000) / 10000.;
+		head.x += ::cosf(angle) * snake_step;
+		head.y += ::sinf(angle) * snake_step;
+		xy = head;
+	}
+
+	bench_run("squeeze coordinate_t", config, [&]()
+		{
+			bench_sink += squeeze_run<coordinate_t>(head_list, length).back().x;
+		});
+	bench_run("squeeze fixed_t<12>", config, [&]()
+		{
+			bench_sink += squeeze_run<fixed_t<12>>(head_list, length).back().x.raw;
+		});
+
+	const std::deque<basic_xy_t<double>> ref = squeeze_run<double>(head_list, length);
+	printf("squeeze drift coordinate_t  %g\n", squeeze_drift(squeeze_run<coordinate_t>(head_list, length), ref));
+	printf("squeeze drift fixed_t<12>   %g\n", squeeze_drift(squeeze_run<fixed_t<12>>(head_list, length), ref));
+}
+
+typedef std::vector<std::vector<uint8_t>> pkt_list_t;
+
+static bool pkt_list_read(const std::string& path, pkt_list_t& pkt_list)
+{
+	FILE* fh = fopen(path.c_str(), "r");
+	if (fh == nullptr)
+	{
+		ERR("can not open file:%s", path.c_str());
+		return false;
+	}
+	game_evt_rec_hdr_t rec_hdr;
+	while (fread(&rec_hdr, sizeof(rec_hdr), 1, fh) == 1)
+	{
+		std::vector<uint8_t> pkt(rec_hdr.size);
+		if (fread(pkt.data(), 1, pkt.size(), fh) != pkt.size())
+			break;
+		pkt_list.push_back(std::move(pkt));
+	}
+	fclose(fh);
+	return true;
+}
+
+// whole recording through game_t with screen_null_t, once without and once with draw()
+static void bench_replay(const config_t& config)
+{
+	pkt_list_t pkt_list;
+	if (!pkt_list_read(config.play_file, pkt_list) || pkt_list.empty())
+		return;
+	size_t byte_cnt = 0;
+	for (const std::vector<uint8_t>& pkt : pkt_list)
+		byte_cnt += pkt.size();
+
+	screen_null_t screen(1280, 800);
+	{
+		const std::unique_ptr<game_t> game(new game_t(screen));
+		const uint64_t start_us = uptime_us();
+		for (const std::vector<uint8_t>& pkt : pkt_list)
+			game->pkt_handle(pkt.data(), pkt.size(), uptime_us());
+		const uint64_t time_us = uptime_us() - start_us;
+		printf("%-32s %8.2f ns/pkt %zu pkt %.1f MB/s\n", "replay decode",
+			1000. * time_us / pkt_list.size(), pkt_list.size(), 1. * byte_cnt / std::max<uint64_t>(time_us, 1));
+	}
+	{
+		const std::unique_ptr<game_t> game(new game_t(screen));
+		game->quality_governor.enabled = false;
+		const size_t present_cnt = screen.present_cnt;
+		const uint64_t start_us = uptime_us();
+		for (const std::vector<uint8_t>& pkt : pkt_list)
+		{
+			game->pkt_handle(pkt.data(), pkt.size(), uptime_us());
+			if (game->ready())
+				game->draw();
+		}
+		const uint64_t time_us = uptime_us() - start_us;
+		const size_t draw_cnt = screen.present_cnt - present_cnt;
+		printf("%-32s %8.2f us/draw %zu draw\n", "replay decode+draw",
+			1. * time_us / std::max<size_t>(draw_cnt, 1), draw_cnt);
+	}
+}
+
+// LOG call cost with the site enabled, in bursts the log thread drains in between
+static void bench_log()
+{
+	static const size_t burst = 1024;
+	static const size_t burst_cnt = 64;
+	if (!log_start("debug", "slithercc_bench", "/dev/null"))
+		return;
+	uint64_t time_ns = 0;
+	for (size_t burst_idx = 0; burst_idx < burst_cnt; ++burst_idx)
+	{
+		const uint64_t start_ns = uptime_ns();
+		for (size_t idx = 0; idx < burst; ++idx)
+			LOG("idx:%zu x:%f name:%s", idx, idx * 0.5, "bench");
+		time_ns += uptime_ns() - start_ns;
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	}
+	log_stop();
+	printf("%-32s %8.2f ns/op\n", "LOG enabled", 1. * time_ns / (burst * burst_cnt));
+	const uint64_t start_ns = uptime_ns();
+	for (size_t idx = 0; idx < burst * burst_cnt; ++idx)
+		LOG("idx:%zu x:%f name:%s", idx, idx * 0.5, "bench");
+	printf("%-32s %8.2f ns/op\n", "LOG disabled", 1. * (uptime_ns() - start_ns) / (burst * burst_cnt));
+}
+
+// per call cost of the time sources, uptime_ns() is what profile zones, LOG and the game use
+static void bench_clock(const config_t& config)
+{
+	printf("clock:%s tsc_mhz:%.3f\n", clock_source(), clock_tsc_mhz());
+	bench_run("uptime_ns", config, [&]()
+		{
+			for (size_t idx = 0; idx < config.count; ++idx)
+				bench_sink += uptime_ns();
+		});
+	bench_run("uptime_us", config, [&]()
+		{
+			for (size_t idx = 0; idx < config.count; ++idx)
+				bench_sink += uptime_us();
+		});
+	bench_run("clock_gettime MONOTONIC", config, [&]()
+		{
+			for (size_t idx = 0; idx < config.count; ++idx)
+				bench_sink += clock_mono_ns();
+		});
+	bench_run("clock_gettime MONOTONIC_RAW", config, [&]()
+		{
+			struct timespec ts = {0, 0};
+			for (size_t idx = 0; idx < config.count; ++idx)
+			{
+				clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+				bench_sink += ts.tv_nsec;
+			}
+		});
+	// how far the calibrated TSC went from CLOCK_MONOTONIC since clock_start()
+	const int64_t drift_ns = static_cast<int64_t>(uptime_ns() - clock_mono_ns());
+	printf("%-32s %8.2f us\n", "uptime_ns - MONOTONIC", drift_ns / 1000.);
+}
+
+// allocations of the replay after the first quarter of it, when containers have grown
+// returns false when over a budget
+static bool bench_replay_alloc(const config_t& config)
+{
+	pkt_list_t pkt_list;
+	if (!pkt_list_read(config.play_file, pkt_list) || pkt_list.empty())
+		return true;
+	screen_null_t screen(1280, 800);
+	const std::unique_ptr<game_t> game(new game_t(screen));
+	game->quality_governor.enabled = false;
+	const size_t warm_up_cnt = pkt_list.size() / 4;
+	const alloc_count_t& alloc = alloc_count();
+	alloc_count_t draw_alloc{};
+	size_t draw_cnt = 0;
+	pkt_stat_t pkt_stat_begin{};
+	alloc_track_on = true;
+	for (size_t idx = 0; idx < pkt_list.size(); ++idx)
+	{
+		if (idx == warm_up_cnt)
+			pkt_stat_begin = game->pkt_stat;
+		game->pkt_handle(pkt_list[idx].data(), pkt_list[idx].size(), uptime_us());
+		if (!game->ready())
+			continue;
+		const alloc_count_t begin = alloc;
+		game->draw();
+		if (idx < warm_up_cnt)
+			continue;
+		draw_alloc.alloc_cnt += alloc.alloc_cnt - begin.alloc_cnt;
+		draw_alloc.alloc_bytes += alloc.alloc_bytes - begin.alloc_bytes;
+		draw_cnt++;
+	}
+	alloc_track_on = false;
+
+	pkt_type_stat_t pkt_alloc{};
+	std::vector<uint8_t> type_list;
+	for (size_t type = 0; type < pkt_type_count; ++type)
+	{
+		pkt_type_stat_t& stat = game->pkt_stat.type_list[type];
+		const pkt_type_stat_t& begin = pkt_stat_begin.type_list[type];
+		stat.count -= begin.count;
+		stat.alloc_cnt -= begin.alloc_cnt;
+		stat.alloc_bytes -= begin.alloc_bytes;
+		pkt_alloc.count += stat.count;
+		pkt_alloc.alloc_cnt += stat.alloc_cnt;
+		pkt_alloc.alloc_bytes += stat.alloc_bytes;
+		if (stat.alloc_cnt > 0)
+			type_list.push_back(type);
+	}
+	const double draw_alloc_avg = 1. * draw_alloc.alloc_cnt / std::max<size_t>(draw_cnt, 1);
+	const double pkt_alloc_avg = 1. * pkt_alloc.alloc_cnt / std::max<uint64_t>(pkt_alloc.count, 1);
+	printf("%-32s %8.2f alloc/draw %8.0f B/draw\n", "replay allocations", draw_alloc_avg,
+		1. * draw_alloc.alloc_bytes / std::max<size_t>(draw_cnt, 1));
+	printf("%-32s %8.2f alloc/pkt %9.0f B/pkt\n", "", pkt_alloc_avg,
+		1. * pkt_alloc.alloc_bytes / std::max<uint64_t>(pkt_alloc.count, 1));
+	for (uint8_t type : type_list)
+	{
+		const pkt_type_stat_t& stat = game->pkt_stat.type_list[type];
+		printf("  pkt %-26c %8.2f alloc/pkt %9.0f B/pkt\n", type, 1. * stat.alloc_cnt / stat.count,
+			1. * stat.alloc_bytes / stat.count);
+	}
+	bool ok = true;
+	if (config.alloc_draw_max >= 0 && draw_alloc_avg > config.alloc_draw_max)
+	{
+		ERR("alloc/draw:%.2f over alloc_draw_max:%.2f", draw_alloc_avg, config.alloc_draw_max);
+		ok = false;
+	}
+	if (config.alloc_pkt_max >= 0 && pkt_alloc_avg > config.alloc_pkt_max)
+	{
+		ERR("alloc/pkt:%.2f over alloc_pkt_max:%.2f", pkt_alloc_avg, config.alloc_pkt_max);
+		ok = false;
+	}
+	return ok;
+}
+
+static void fast_trig_error_print()
+{
+	double sin_err = 0.;
+	double cos_err = 0.;
+	double atan2_err = 0.;
+	for (float x = -100.; x < 100.; x += 0.0001)
+	{
+		sin_err = std::max(sin_err, std::fabs(fast_sinf(x) - std::sin(static_cast<double>(x))));
+		cos_err = std::max(cos_err, std::fabs(fast_cosf(x) - std::cos(static_cast<double>(x))));
+	}
+	for (float ang = -M_PI; ang < M_PI; ang += 0.00001)
+	{
+		const float y = std::sin(ang);
+		const float x = std::cos(ang);
+		const double ang_ref = std::atan2(static_cast<double>(y), static_cast<double>(x));
+		atan2_err = std::max(atan2_err, std::fabs(fast_atan2f(y, x) - ang_ref));
+	}
+	printf("fast_sinf max error   %g\n", sin_err);
+	printf("fast_cosf max error   %g\n", cos_err);
+	printf("fast_atan2f max error %g\n", atan2_err);
+}
+
+int main(int argc, const char* argv[])
+{
+	clock_start();
+	run_time_us();
+	config_t config = parse_opts(argc, argv);
+	if (config.count == 0 || config.repeat == 0)
+	{
+		ERR("count and repeat must be > 0");
+		return EXIT_FAILURE;
+	}
+	printf("count:%zu repeat:%zu\n", config.count, config.repeat);
+	bench_geometry(config);
+	bench_kinematics(config);
+	bench_squeeze(config);
+	bench_clock(config);
+	if (!config.play_file.empty())
+	{
+		if (!config.trace_file.empty() && !trace_start(config.trace_file))
+			return EXIT_FAILURE;
+		bench_replay(config);
+		trace_stop();
+		if (!bench_replay_alloc(config))
+			return EXIT_FAILURE;
+	}
+	bench_log();
+	fast_trig_error_print();
+	return EXIT_SUCCESS;
+}
@@ -4,9 +4,14 @@
 #include "packet_to_server.h"
 #include "connect.h"
 #include "game.h"
+#include "screen_sdl.h"
 #include "game_rec.h"
+#include "alloc.h"
 #include "log.h"
+#include "profile.h"
+#include "trace.h"
 #include "ioc.h"
+#include "metrics.h"
 #include "timerfd_grid.h"
 #include "decode_secret.h"
 
@@ -17,6 +22,8 @@
 #include <chrono>
 #include <thread>
 #include <memory>
+#include <ctime>
+#include <cctype>
 
 sig_atomic_t run = 1;
 
@@ -37,23 +44,30 @@ void signal_handler_register()
 }
 
 FILE* game_evt_rec_fh;
-void game_evt_rec(const void* data, size_t size)
+void game_evt_rec(const void* data, size_t size, uint64_t rx_us)
 {
 	if (game_evt_rec_fh == nullptr)
 		return;
-	game_evt_rec_hdr_t hdr{uptime_us(), size};
+	game_evt_rec_hdr_t hdr{rx_us, size};
 	fwrite(&hdr, sizeof(hdr), 1, game_evt_rec_fh);
 	fwrite(data, size, 1, game_evt_rec_fh);
 }
 
 typedef std::vector<uint8_t> pkt_vec_t;
-static std::deque<pkt_vec_t> pkt_queue;
+// arrival time taken on the read thread, the draw loop empties the queue once a frame
+struct pkt_rx_t
+{
+	uint64_t rx_us;
+	pkt_vec_t data;
+};
+static std::deque<pkt_rx_t> pkt_queue;
 std::mutex pkt_queue_lock;
 
 std::mutex rw_lock;
 
 void read_thread_func(websocket::stream<tcp::socket>& ws)
 {
+	trace_thread_name("net");
 	while(run)
 	{
 		{
@@ -64,7 +78,13 @@ void read_thread_func(websocket::stream<tcp::socket>& ws)
 				break;
 			}
 			boost::beast::multi_buffer buffer;
-			ws_read(ws, buffer);
+			{
+				// permessage deflate inflates inside the read
+				TRACE_SCOPE("ws_read");
+				ws_read(ws, buffer);
+			}
+			const uint64_t rx_us = uptime_us();
+			PROFILE_ZONE("net_read");
 			for (const boost::asio::const_buffer& sbuf : buffer.data())
 			{
 				if (sbuf.size() < sizeof(pkt_hdr_t))
@@ -73,9 +93,9 @@ void read_thread_func(websocket::stream<tcp::socket>& ws)
 				const uint8_t* data_end = static_cast<const uint8_t*>(sbuf.data()) + sbuf.size();
 				{
 					std::lock_guard<std::mutex> lock_guard(pkt_queue_lock);
-					pkt_queue.emplace_back(pkt_vec_t(data_begin, data_end));
+					pkt_queue.emplace_back(pkt_rx_t{rx_us, pkt_vec_t(data_begin, data_end)});
 				}
-				game_evt_rec(sbuf.data(), sbuf.size());
+				game_evt_rec(sbuf.data(), sbuf.size(), rx_us);
 			}
 		}
 	}
@@ -83,6 +103,7 @@ void read_thread_func(websocket::stream<tcp::socket>& ws)
 
 void play_rec(FILE* fh)
 {
+	trace_thread_name("play");
 	uint64_t rec_us = 0;
 	uint64_t rec_us_prev = 0;
 	ssize_t size = 0;
@@ -104,7 +125,7 @@ void play_rec(FILE* fh)
 		std::this_thread::sleep_for(std::chrono::microseconds(wait_us));
 		{
 			std::lock_guard<std::mutex> lock_guard(pkt_queue_lock);
-			pkt_queue.emplace_back(pkt_vec_t(buf, buf + rec_hdr.size));
+			pkt_queue.emplace_back(pkt_rx_t{uptime_us(), pkt_vec_t(buf, buf + rec_hdr.size)});
 		}
 		rec_us_prev = rec_us;
 	}
@@ -126,6 +147,86 @@ void setup_stream(websocket::stream<NextLayer>& ws)
     ws.read_message_max(64 * 1024 * 1024);
 }
 
+// metrics page, runs on the metrics thread so only game_t snapshots are read
+static std::string metrics_text_game(game_t& game)
+{
+	pkt_stat_t pkt_stat;
+	game_snap_t snap;
+	{
+		std::lock_guard<std::mutex> lock_guard(game.pkt_stat_lock);
+		pkt_stat = game.pkt_stat_snap;
+		snap = game.snap;
+	}
+	std::string text;
+	metrics_add(text, "gauge", "slithercc_frame_seconds{quantile=\"0.5\"}", snap.frame_stat.p50_ns / 1e9);
+	metrics_add(text, "gauge", "slithercc_frame_seconds{quantile=\"0.99\"}", snap.frame_stat.p99_ns / 1e9);
+	metrics_add(text, "gauge", "slithercc_frame_seconds{quantile=\"1\"}", snap.frame_stat.max_ns / 1e9);
+	metrics_add(text, "gauge", "slithercc_draw_seconds{quantile=\"0.5\"}", snap.draw_stat.p50_ns / 1e9);
+	metrics_add(text, "gauge", "slithercc_draw_seconds{quantile=\"0.99\"}", snap.draw_stat.p99_ns / 1e9);
+	metrics_add(text, "counter", "slithercc_frames_total", snap.frame_cnt);
+	metrics_add(text, "counter", "slithercc_slow_frames_total", snap.slow_cnt);
+	metrics_add(text, "gauge", "slithercc_packet_queue_depth", snap.queue_depth);
+	// one group per metric family, a repeated TYPE line is invalid exposition format
+	static const char* const family_list[] = {"slithercc_packets_total", "slithercc_packet_bytes_total",
+		"slithercc_packet_rejects_total", "slithercc_packet_decode_seconds_total"};
+	char name[96];
+	for (size_t family = 0; family < sizeof(family_list) / sizeof(family_list[0]); ++family)
+		for (size_t type = 0; type < pkt_type_count; ++type)
+		{
+			const pkt_type_stat_t& type_stat = pkt_stat.type_list[type];
+			if (type_stat.count == 0)
+				continue;
+			if (isalnum(type))
+				snprintf(name, sizeof(name), "%s{type=\"%c\"}", family_list[family], static_cast<char>(type));
+			else
+				snprintf(name, sizeof(name), "%s{type=\"0x%02zx\"}", family_list[family], type);
+			const double value_list[] = {double(type_stat.count), double(type_stat.bytes),
+				double(type_stat.reject), type_stat.decode_ns / 1e9};
+			metrics_add(text, "counter", name, value_list[family]);
+		}
+	metrics_add(text, "gauge", "slithercc_rtt_seconds{quantile=\"0.5\"}", snap.rtt_p50_us / 1e6);
+	metrics_add(text, "gauge", "slithercc_rtt_seconds{quantile=\"0.99\"}", snap.rtt_p99_us / 1e6);
+	metrics_add(text, "counter", "slithercc_pings_total", snap.ping_cnt);
+	metrics_add(text, "counter", "slithercc_pings_lost_total", snap.ping_lost_cnt);
+	metrics_add(text, "gauge", "slithercc_resident_bytes", proc_status_bytes("VmRSS"));
+	metrics_add(text, "gauge", "slithercc_text_cache_entries", snap.text_cache_cnt);
+	metrics_add(text, "counter", "slithercc_textures_created_total", snap.texture_cnt);
+	metrics_add(text, "gauge", "slithercc_snakes", snap.snake_cnt);
+	metrics_add(text, "gauge", "slithercc_food", snap.food_cnt);
+	metrics_add(text, "gauge", "slithercc_prey", snap.prey_cnt);
+	metrics_add(text, "gauge", "slithercc_sectors", snap.sector_cnt);
+	return text;
+}
+
+// one row per run appended to path for comparing builds, main thread after the game loop
+static void metrics_csv_write(game_t& game, const std::string& path)
+{
+	FILE* fh = fopen(path.c_str(), "a");
+	if (fh == nullptr)
+	{
+		ERR("can not open file:%s", path.c_str());
+		return;
+	}
+	if (ftell(fh) == 0)
+		fprintf(fh, "time,run_s,frames,frame_p50_ms,frame_p99_ms,slow_frames,"
+			"pkt,decode_ns_per_pkt,rtt_p50_ms,rtt_p99_ms,pings_lost,rss_peak_mb\n");
+	uint64_t pkt_cnt = 0;
+	uint64_t decode_ns = 0;
+	for (const pkt_type_stat_t& type_stat : game.pkt_stat.type_list)
+	{
+		pkt_cnt += type_stat.count;
+		decode_ns += type_stat.decode_ns;
+	}
+	const watchdog_t& watchdog = game.watchdog;
+	fprintf(fh, "%ld,%.1f,%zu,%.2f,%.2f,%zu,%lu,%.0f,%.1f,%.1f,%zu,%.1f\n",
+		static_cast<long>(time(nullptr)), run_time_us() / 1e6, watchdog.frame_cnt,
+		profile_hist_percentile(watchdog.gap_hist, 0.5) / 1e6, profile_hist_percentile(watchdog.gap_hist, 0.99) / 1e6,
+		watchdog.slow_cnt, pkt_cnt, 1. * decode_ns / std::max<uint64_t>(pkt_cnt, 1),
+		game.ping_ctx.rtt.percentile_us(0.5) / 1e3, game.ping_ctx.rtt.percentile_us(0.99) / 1e3,
+		game.ping_ctx.lost_cnt, proc_status_bytes("VmHWM") / 1e6);
+	fclose(fh);
+}
+
 struct config_t
 {
 	std::string server;
@@ -133,8 +234,20 @@ struct config_t
 	std::string nickname;
 	int skin_id;
 	std::string record_file;
+	std::string trace_file;
+	std::string log_level;
+	std::string log_category;
+	std::string log_file;
+	bool alloc_track;
+	unsigned short metrics_port;  // 0 - off
+	std::string metrics_csv;
 	std::string play_file;
 	xy_t window_size;
+	float part_lod;
+	float render_scale;
+	size_t jobs;
+	std::string renderer;
+	ssize_t quality;  // < 0 - auto
 	bool show_usage;
 };
 
@@ -145,6 +258,8 @@ void usage()
 	<< "slither.io client\n"
 	<< "\n"
 	<< "The snake follows mouse pointer. Hold left mouse button to accelerate.\n"
+	<< "Mouse wheel zooms in and out.\n"
+	<< "p toggles the profiler overlay, r prints the slow frame reports.\n"
 	<< "Eat color dots and flying prey. If you hit other snake you die.\n"
 	<< "\n"
 	<< "Usage examples:\n"
@@ -167,6 +282,10 @@ void usage()
 config_t parse_opts(int argc, const char* argv[])
 {
 	config_t config{};
+	config.part_lod = part_lod_default;
+	config.render_scale = 1.;
+	config.jobs = std::thread::hardware_concurrency();
+	config.quality = -1;
 	for (ssize_t idx = 1; idx < argc; ++idx)
 	{
 		std::string opt = argv[idx];
@@ -183,6 +302,20 @@ config_t parse_opts(int argc, const char* argv[])
 			config.skin_id = strtol(key_val.val.c_str(), NULL, 10);
 		else if (key_val.key == "record_file")
 			config.record_file = key_val.val;
+		else if (key_val.key == "trace_file")
+			config.trace_file = key_val.val;
+		else if (key_val.key == "log_level")
+			config.log_level = key_val.val;
+		else if (key_val.key == "log_category")
+			config.log_category = key_val.val;
+		else if (key_val.key == "log_file")
+			config.log_file = key_val.val;
+		else if (key_val.key == "alloc_track")
+			config.alloc_track = strtol(key_val.val.c_str(), NULL, 10) != 0;
+		else if (key_val.key == "metrics_port")
+			config.metrics_port = strtoul(key_val.val.c_str(), NULL, 10);
+		else if (key_val.key == "metrics_csv")
+			config.metrics_csv = key_val.val;
 		else if (key_val.key == "play_file")
 			config.play_file = key_val.val;
 		else if (key_val.key == "window_size")
@@ -192,6 +325,16 @@ config_t parse_opts(int argc, const char* argv[])
 			config.window_size.x = strtol(win_sz_key_val.key.c_str(), NULL, 10);
 			config.window_size.y = strtol(win_sz_key_val.val.c_str(), NULL, 10);
 		}
+		else if (key_val.key == "part_lod")
+			config.part_lod = strtof(key_val.val.c_str(), NULL);
+		else if (key_val.key == "render_scale")
+			config.render_scale = strtof(key_val.val.c_str(), NULL);
+		else if (key_val.key == "renderer")
+			config.renderer = key_val.val;
+		else if (key_val.key == "jobs")
+			config.jobs = strtoul(key_val.val.c_str(), NULL, 10);
+		else if (key_val.key == "quality")
+			config.quality = key_val.val == "auto" ? -1 : strtol(key_val.val.c_str(), NULL, 10);
 		else if (key_val.key == "-h" || key_val.key == "h")
 			config.show_usage = true;
 		else if (key_val.key == "--help" || key_val.key == "help")
@@ -202,6 +345,7 @@ config_t parse_opts(int argc, const char* argv[])
 
 int main(int argc, const char* argv[])
 {
+	clock_start();
 	run_time_us();
 	config_t config = parse_opts(argc, argv);
 	if (config.show_usage)
@@ -209,12 +353,42 @@ int main(int argc, const char* argv[])
 		usage();
 		return EXIT_SUCCESS;
 	}
+	// the log and trace writer threads must be joined on every return,
+	// a joinable std::thread terminates
+	struct log_trace_stop_t
+	{
+		~log_trace_stop_t()
+		{
+			trace_stop();
+			log_stop();
+		}
+	} log_trace_stop_guard;
+	if (!log_start(config.log_level, config.log_category, config.log_file))
+		return EXIT_FAILURE;
+	LOG_INFO("clock:%s tsc_mhz:%.3f", clock_source(), clock_tsc_mhz());
+	if (config.trace_file.length() > 0 && !trace_start(config.trace_file))
+		return EXIT_FAILURE;
+	trace_thread_name("main");
+	alloc_track_on = config.alloc_track;
 	std::string font_path = realpath_str(std::string(argv[0]));
 	font_path = dirname(font_path) + "/Arimo-Regular.ttf";
 	screen_sdl_t screen(config.window_size.x, config.window_size.y, font_path);
 	screen.window_title("slithercc");
 	const std::unique_ptr<game_t> game_p(new game_t(screen));
 	game_t& game = *game_p.get();
+	game.draw_quality_base.part_lod = config.part_lod;
+	game.draw_quality_base.render_scale = config.render_scale;
+	if (config.quality >= 0)
+	{
+		game.quality_governor.enabled = false;
+		game.quality_governor.level = std::min<size_t>(config.quality, quality_level_count - 1);
+	}
+	game.draw_quality_apply();
+	// the SDL thread is one of the jobs threads
+	game.job_system.start(config.jobs > 1 ? config.jobs - 1 : 0);
+	// one pool for prepare jobs and soft raster tiles, they never run at the same time
+	if (config.renderer == "soft")
+		screen.soft_start(game.job_system);
 	bool play_file = config.play_file.length() > 0 ? true : false;
 	bool test_server = config.test_server.length() > 0 ? true : false;
 	skin_config_t skin_config{config.skin_id, config.nickname.c_str()};
@@ -269,6 +443,8 @@ int main(int argc, const char* argv[])
 		read_tread = std::thread(read_thread_func, std::ref(ws));
 	}
 
+	if (config.metrics_port != 0 && !metrics_start(config.metrics_port, [&game]() { return metrics_text_game(game); }))
+		run = false;
 	signal_handler_register();
 
 	while (run)
@@ -278,10 +454,11 @@ int main(int argc, const char* argv[])
 			std::lock_guard<std::mutex> lock_guard(pkt_queue_lock);
 			pkt_cnt = pkt_queue.size();
 		}
+		game.watchdog.queue_depth = pkt_cnt;
 		for (; pkt_cnt > 0; --pkt_cnt)
 		{
-			const pkt_vec_t& pkt = pkt_queue.front();
-			game.pkt_handle(pkt.data(), pkt.size());
+			const pkt_rx_t& pkt = pkt_queue.front();
+			game.pkt_handle(pkt.data.data(), pkt.data.size(), pkt.rx_us);
 			{
 				std::lock_guard<std::mutex> lock_guard(pkt_queue_lock);
 				pkt_queue.pop_front();
@@ -289,7 +466,10 @@ int main(int argc, const char* argv[])
 		}
 		if (!game.ready())
 			continue;
-		timerfd_grid_us_wait<draw_period_us>();
+		{
+			TRACE_SCOPE("timer_wait");
+			timerfd_grid_us_wait<draw_period_us>();
+		}
 		game.draw();
 		if (play_file)
 			continue;
@@ -305,6 +485,11 @@ int main(int argc, const char* argv[])
 			run = false;
 	}
 	read_tread.join();
+	metrics_stop();
+	if (game.watchdog.ring_cnt > 0)
+		game.watchdog.dump(stderr);
+	if (!config.metrics_csv.empty())
+		metrics_csv_write(game, config.metrics_csv);
 
 	if (!screen.quit)
 	{
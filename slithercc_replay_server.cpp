@@ -2,6 +2,8 @@
 #include <boost/beast/core.hpp>
 #include <boost/beast/websocket.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <atomic>
+#include <csignal>
 #include <cstdlib>
 #include <functional>
 #include <iostream>
@@ -14,6 +16,7 @@
 #include "game_rec.h"
 #include "clock.h"
 #include "log.h"
+#include "metrics.h"
 #include "util.h"
 
 using tcp = boost::asio::ip::tcp;               // from <boost/asio/ip/tcp.hpp>
@@ -32,6 +35,29 @@ typedef std::deque<pkt_t> pkt_queue_t;
 
 FILE* game_evt_rec_fh;
 
+sig_atomic_t run = 1;
+
+// for the metrics page
+static std::atomic<size_t> session_cnt(0);
+static std::atomic<size_t> session_active_cnt(0);
+static std::atomic<uint64_t> pkt_sent_cnt(0);
+static std::atomic<uint64_t> byte_sent_cnt(0);
+
+void signal_handler(int sig_num)
+{
+	(void)sig_num;
+	run = 0;
+}
+
+// no SA_RESTART, the blocking accept() returns so main() can write the summary
+void signal_handler_register()
+{
+	struct sigaction sigact = {};
+	sigact.sa_handler = signal_handler;
+	if (0 != sigaction(SIGINT, &sigact, NULL) || 0 != sigaction(SIGTERM, &sigact, NULL))
+		ERR("failed: sigaction()");
+}
+
 // Adjust settings on the stream
 template<class NextLayer>
 void
@@ -82,6 +108,8 @@ std::vector<uint8_t> rec_data;
 
 void do_session1(tcp::socket& socket, const pkt_queue_t& pkt_queue_all)
 {
+	session_cnt++;
+	session_active_cnt++;
     try
     {
         websocket::stream<tcp::socket> ws{std::move(socket)};
@@ -114,10 +142,14 @@ void do_session1(tcp::socket& socket, const pkt_queue_t& pkt_queue_all)
 				{
 					boost::asio::const_buffer buffer(pkt1.data(), pkt1.size());
 					ws.write(buffer);
+					pkt_sent_cnt++;
+					byte_sent_cnt += pkt1.size();
 				}
 				pkt_queue.clear();
 				boost::asio::const_buffer buffer(pkt.data.data(), pkt.data.size());
 				ws.write(buffer);
+				pkt_sent_cnt++;
+				byte_sent_cnt += pkt.data.size();
 			}
 			else
 				pkt_queue.push_back(pkt.data);
@@ -134,6 +166,34 @@ void do_session1(tcp::socket& socket, const pkt_queue_t& pkt_queue_all)
     {
         std::cerr << "Error: " << e.what() << std::endl;
     }
+	session_active_cnt--;
+}
+
+static std::string metrics_text_replay()
+{
+	std::string text;
+	metrics_add(text, "counter", "slithercc_replay_sessions_total", session_cnt);
+	metrics_add(text, "gauge", "slithercc_replay_sessions_active", session_active_cnt);
+	metrics_add(text, "counter", "slithercc_replay_packets_sent_total", pkt_sent_cnt);
+	metrics_add(text, "counter", "slithercc_replay_bytes_sent_total", byte_sent_cnt);
+	metrics_add(text, "gauge", "slithercc_resident_bytes", proc_status_bytes("VmRSS"));
+	return text;
+}
+
+// one row per run appended to path
+static void metrics_csv_write(const std::string& path)
+{
+	FILE* fh = fopen(path.c_str(), "a");
+	if (fh == nullptr)
+	{
+		ERR("can not open file:%s", path.c_str());
+		return;
+	}
+	if (ftell(fh) == 0)
+		fprintf(fh, "time,run_s,sessions,pkt_sent,bytes_sent,rss_peak_mb\n");
+	fprintf(fh, "%ld,%.1f,%zu,%lu,%lu,%.1f\n", static_cast<long>(time(nullptr)), run_time_us() / 1e6,
+		session_cnt.load(), pkt_sent_cnt.load(), byte_sent_cnt.load(), proc_status_bytes("VmHWM") / 1e6);
+	fclose(fh);
 }
 
 struct config_t
@@ -141,6 +201,10 @@ struct config_t
 	std::string address;
 	unsigned short port;
 	std::string play_file;
+	std::string log_level;
+	std::string log_category;
+	unsigned short metrics_port;  // 0 - off
+	std::string metrics_csv;
 };
 
 config_t parse_opts(int argc, const char* argv[])
@@ -163,12 +227,21 @@ config_t parse_opts(int argc, const char* argv[])
 		}
 		else if (key_val.key == "play_file")
 			config.play_file = key_val.val;
+		else if (key_val.key == "log_level")
+			config.log_level = key_val.val;
+		else if (key_val.key == "log_category")
+			config.log_category = key_val.val;
+		else if (key_val.key == "metrics_port")
+			config.metrics_port = strtoul(key_val.val.c_str(), NULL, 10);
+		else if (key_val.key == "metrics_csv")
+			config.metrics_csv = key_val.val;
 	}
 	return config;
 }
 
 int main(int argc, const char* argv[])
 {
+	clock_start();
 	run_time_us();
 	config_t config = parse_opts(argc, argv);
 	if (config.play_file.length() == 0)
@@ -176,9 +249,18 @@ int main(int argc, const char* argv[])
 		ERR("please specify play_file=[file]");
 		return EXIT_FAILURE;
 	}
+	if (!log_start(config.log_level, config.log_category, ""))
+		return EXIT_FAILURE;
 	pkt_queue_t pkt_queue = read_rec_file(config.play_file.c_str());
 	LOG("pkt_queue.size():%zu", pkt_queue.size());
+	if (config.metrics_port != 0 && !metrics_start(config.metrics_port, metrics_text_replay))
+	{
+		log_stop();
+		return EXIT_FAILURE;
+	}
+	signal_handler_register();
 
+	int ret = EXIT_SUCCESS;
     try
     {
         auto const address = boost::asio::ip::make_address(config.address.c_str());
@@ -186,7 +268,7 @@ int main(int argc, const char* argv[])
 
         boost::asio::io_context ioc{1};
         tcp::acceptor acceptor{ioc, {address, port}};
-        for(;;)
+        while (run)
         {
             tcp::socket socket{ioc};
             acceptor.accept(socket);  // Block until we get a connection
@@ -195,7 +277,16 @@ int main(int argc, const char* argv[])
     }
     catch (const std::exception& e)
     {
-        std::cerr << "Error: " << e.what() << std::endl;
-        return EXIT_FAILURE;
+        // accept() interrupted by SIGINT or SIGTERM is the way out
+        if (run)
+        {
+            std::cerr << "Error: " << e.what() << std::endl;
+            ret = EXIT_FAILURE;
+        }
     }
+	metrics_stop();
+	if (!config.metrics_csv.empty())
+		metrics_csv_write(config.metrics_csv);
+	log_stop();
+	return ret;
 }
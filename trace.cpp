@@ -0,0 +1,182 @@
+#include "trace.h"
+#include "log.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+std::atomic<bool> trace_on(false);
+
+static const size_t trace_ring_size = 1 << 16;  // events per thread between two drains
+static const uint64_t trace_drain_period_us = 100000;
+
+struct trace_event_t
+{
+	const char* name;
+	uint64_t begin_ns;
+	uint64_t end_ns;
+};
+
+// written by its own thread only, read by the writer thread only
+struct trace_ring_t
+{
+	trace_ring_t()
+	: event_list(trace_ring_size)
+	, head(0)
+	, tail(0)
+	, drop_cnt(0)
+	, tid(syscall(SYS_gettid))
+	, name(nullptr)
+	, name_written(nullptr)
+	{
+	}
+
+	std::vector<trace_event_t> event_list;
+	std::atomic<size_t> head;  // next to write
+	std::atomic<size_t> tail;  // next to read
+	std::atomic<size_t> drop_cnt;
+	long tid;
+	std::atomic<const char*> name;
+	const char* name_written;  // writer thread only
+};
+
+static std::mutex ring_list_lock;
+static std::vector<std::unique_ptr<trace_ring_t>> ring_list;  // kept after their threads end
+static thread_local trace_ring_t* ring_local;
+static thread_local const char* thread_name_local;  // kept until the thread's first event
+static FILE* trace_fh;
+static uint64_t trace_start_ns;
+static bool event_first;
+static std::thread writer;
+static std::mutex writer_lock;
+static std::condition_variable writer_cv;
+static bool writer_quit;
+
+static trace_ring_t& ring_get()
+{
+	if (ring_local != nullptr)
+		return *ring_local;
+	std::unique_ptr<trace_ring_t> ring(new trace_ring_t());
+	ring->name = thread_name_local;
+	ring_local = ring.get();
+	std::lock_guard<std::mutex> lock_guard(ring_list_lock);
+	ring_list.push_back(std::move(ring));
+	return *ring_local;
+}
+
+void trace_event(const char* name, uint64_t begin_ns, uint64_t end_ns)
+{
+	trace_ring_t& ring = ring_get();
+	const size_t head = ring.head.load(std::memory_order_relaxed);
+	if (head - ring.tail.load(std::memory_order_acquire) >= trace_ring_size)
+	{
+		ring.drop_cnt.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	ring.event_list[head % trace_ring_size] = trace_event_t{name, begin_ns, end_ns};
+	ring.head.store(head + 1, std::memory_order_release);
+}
+
+// no ring here, threads that never trace while trace_on do not pay for one
+void trace_thread_name(const char* name)
+{
+	thread_name_local = name;
+	if (ring_local != nullptr)
+		ring_local->name = name;
+}
+
+static void ring_drain(trace_ring_t& ring)
+{
+	// thread names go out with the events so a trace cut short by a crash keeps them
+	const char* name = ring.name;
+	if (name != nullptr && name != ring.name_written)
+	{
+		fprintf(trace_fh, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%ld,\"args\":{\"name\":\"%s\"}}",
+			event_first ? "" : ",\n", getpid(), ring.tid, name);
+		event_first = false;
+		ring.name_written = name;
+	}
+	const size_t head = ring.head.load(std::memory_order_acquire);
+	size_t tail = ring.tail.load(std::memory_order_relaxed);
+	for (; tail != head; ++tail)
+	{
+		const trace_event_t& event = ring.event_list[tail % trace_ring_size];
+		// a profile scope may have begun before trace_start()
+		const int64_t ts_ns = static_cast<int64_t>(event.begin_ns - trace_start_ns);
+		fprintf(trace_fh, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%ld,\"ts\":%.3f,\"dur\":%.3f}",
+			event_first ? "" : ",\n", event.name, getpid(), ring.tid,
+			ts_ns / 1000., (event.end_ns - event.begin_ns) / 1000.);
+		event_first = false;
+	}
+	ring.tail.store(tail, std::memory_order_release);
+}
+
+static void ring_list_drain()
+{
+	std::lock_guard<std::mutex> lock_guard(ring_list_lock);
+	for (std::unique_ptr<trace_ring_t>& ring : ring_list)
+		ring_drain(*ring);
+	fflush(trace_fh);
+}
+
+static void writer_func()
+{
+	trace_thread_name("trace");
+	std::unique_lock<std::mutex> lock(writer_lock);
+	while (!writer_quit)
+	{
+		writer_cv.wait_for(lock, std::chrono::microseconds(trace_drain_period_us));
+		lock.unlock();
+		ring_list_drain();
+		lock.lock();
+	}
+}
+
+bool trace_start(const std::string& path)
+{
+	trace_fh = fopen(path.c_str(), "w");
+	if (trace_fh == nullptr)
+	{
+		ERR("can not open file:%s", path.c_str());
+		return false;
+	}
+	// JSON array format, viewers accept it without the closing bracket after a crash
+	fprintf(trace_fh, "[\n");
+	event_first = true;
+	trace_start_ns = uptime_ns();
+	writer_quit = false;
+	writer = std::thread(writer_func);
+	trace_on = true;
+	LOG_INFO("trace_file:%s", path.c_str());
+	return true;
+}
+
+void trace_stop()
+{
+	if (trace_fh == nullptr)
+		return;
+	trace_on = false;
+	{
+		std::lock_guard<std::mutex> lock_guard(writer_lock);
+		writer_quit = true;
+	}
+	writer_cv.notify_all();
+	writer.join();
+	ring_list_drain();
+	std::lock_guard<std::mutex> lock_guard(ring_list_lock);
+	for (std::unique_ptr<trace_ring_t>& ring : ring_list)
+	{
+		ring->name_written = nullptr;  // for the next trace_start()
+		if (ring->drop_cnt > 0)
+			ERR("tid:%ld dropped events:%zu", ring->tid, ring->drop_cnt.load());
+	}
+	fprintf(trace_fh, "\n]\n");
+	fclose(trace_fh);
+	trace_fh = nullptr;
+}
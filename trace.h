@@ -0,0 +1,47 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "clock.h"
+
+#include <atomic>
+#include <string>
+
+#include <stdint.h>
+
+// Timeline of begin/end events written as Chrome trace JSON (open in ui.perfetto.dev).
+// Every thread appends to its own ring buffer without locks, a writer thread started by
+// trace_start() drains the rings to the file every 100 ms. Events are dropped (and
+// counted) when a ring is full. PROFILE_ZONE scopes are traced too.
+
+extern std::atomic<bool> trace_on;
+
+bool trace_start(const std::string& path);
+void trace_stop();
+// name shown for the calling thread, static string
+void trace_thread_name(const char* name);
+void trace_event(const char* name, uint64_t begin_ns, uint64_t end_ns);
+
+struct trace_scope_t
+{
+	explicit trace_scope_t(const char* name_)
+	: name(name_)
+	, begin_ns(trace_on.load(std::memory_order_relaxed) ? uptime_ns() : 0)
+	{
+	}
+
+	~trace_scope_t()
+	{
+		if (begin_ns != 0)
+			trace_event(name, begin_ns, uptime_ns());
+	}
+
+	const char* name;
+	uint64_t begin_ns;
+};
+
+#define TRACE_CAT_(a, b) a##b
+#define TRACE_CAT(a, b) TRACE_CAT_(a, b)
+// name must stay valid until trace_stop(), a literal or a static table entry
+#define TRACE_SCOPE(name) trace_scope_t TRACE_CAT(trace_scope_, __LINE__)(name)
+
+#endif  // TRACE_H
@@ -216,3 +216,11 @@ std::string str_trim(std::string str)
 		str.erase(str.length() - 1);
 	return str;
 }
+
+size_t proc_status_bytes(const std::string& key)
+{
+	const std::string line = file_line_match("/proc/self/status", key + ":");
+	if (!str_starts_with(line, key + ":"))
+		return 0;
+	return strtoull(line.c_str() + key.length() + 1, NULL, 10) * 1024;
+}
@@ -28,5 +28,7 @@ bool str_starts_with(const std::string& str, const std::string& start);
 bool str_ends_with(const std::string& str, const std::string& end);
 std::string str_trim(std::string str);
 str_list_t split_str(const std::string &str, const std::string& delim);
+// /proc/self/status kB line in bytes, "VmRSS" - resident now, "VmHWM" - peak, 0 when missing
+size_t proc_status_bytes(const std::string& key);
 
 #endif  // #ifndef UTIL_H
@@ -0,0 +1,119 @@
+#include "watchdog.h"
+#include "alloc.h"
+
+#include <algorithm>
+
+#include <ctype.h>
+#include <string.h>
+
+watchdog_t::watchdog_t(uint64_t budget_us_)
+: budget_us(budget_us_)
+, queue_depth(0)
+, frame_cnt(0)
+, slow_cnt(0)
+, gap_hist()
+, pkt_type_cnt_list()
+, pkt_cnt(0)
+, pkt_decode_ns(0)
+, stage_list()
+, present_prev_us(0)
+, texture_total_prev(0)
+, alloc_cnt_prev(0)
+, ring()
+, ring_cnt(0)
+{
+	for (std::atomic<uint32_t>& count : gap_hist.count_list)
+		count.store(0, std::memory_order_relaxed);
+}
+
+void watchdog_t::frame_end(uint64_t present_us, uint64_t draw_us, size_t texture_total)
+{
+	// local static as the zone list is only ready after static initialisation
+	static profile_zone_t frame_gap_zone("frame_gap");
+	const uint64_t gap_us = present_us - present_prev_us;
+	if (present_prev_us != 0)
+	{
+		frame_gap_zone.add(gap_us * 1000);
+		gap_hist.count_list[profile_hist_t::bucket(gap_us * 1000)].fetch_add(1, std::memory_order_relaxed);
+		frame_cnt++;
+	}
+	const size_t stage_cnt = profile_frame_take(stage_list, slow_frame_stage_max);
+	const uint64_t alloc_cnt = alloc_count().alloc_cnt;
+	if (present_prev_us != 0 && gap_us >= slow_frame_factor * budget_us)
+	{
+		slow_frame_t& frame = ring[ring_cnt % slow_frame_ring_size];
+		ring_cnt++;
+		slow_cnt++;
+		frame.tstamp_us = run_time_us();
+		frame.gap_us = gap_us;
+		frame.draw_us = draw_us;
+		std::copy(stage_list, stage_list + stage_cnt, frame.stage_list);
+		frame.stage_cnt = stage_cnt;
+		frame.pkt_cnt = pkt_cnt;
+		frame.pkt_decode_ns = pkt_decode_ns;
+		frame.pkt_type_cnt = 0;
+		for (size_t type = 0; type < 256; ++type)
+		{
+			if (pkt_type_cnt_list[type] == 0)
+				continue;
+			// insert into the short list sorted by count
+			const slow_frame_t::pkt_type_cnt_t type_cnt{static_cast<uint8_t>(type), pkt_type_cnt_list[type]};
+			size_t idx = slow_frame_pkt_type_max - 1;
+			if (frame.pkt_type_cnt < slow_frame_pkt_type_max)
+				idx = frame.pkt_type_cnt++;
+			else if (frame.pkt_type_list[idx].count >= type_cnt.count)
+				continue;
+			for (; idx > 0 && frame.pkt_type_list[idx - 1].count < type_cnt.count; --idx)
+				frame.pkt_type_list[idx] = frame.pkt_type_list[idx - 1];
+			frame.pkt_type_list[idx] = type_cnt;
+		}
+		frame.queue_depth = queue_depth;
+		frame.texture_cnt = texture_total - texture_total_prev;
+		frame.alloc_tracked = alloc_track_on.load(std::memory_order_relaxed);
+		frame.alloc_cnt = alloc_cnt - alloc_cnt_prev;
+	}
+	memset(pkt_type_cnt_list, 0, sizeof(pkt_type_cnt_list));
+	pkt_cnt = 0;
+	pkt_decode_ns = 0;
+	present_prev_us = present_us;
+	texture_total_prev = texture_total;
+	alloc_cnt_prev = alloc_cnt;
+}
+
+void watchdog_t::dump(FILE* fh)
+{
+	const size_t first = ring_cnt > slow_frame_ring_size ? ring_cnt - slow_frame_ring_size : 0;
+	fprintf(fh, "slow frames:%zu over %.1f ms, last %zu:\n", slow_cnt,
+		slow_frame_factor * budget_us / 1000., ring_cnt - first);
+	for (size_t cnt = first; cnt < ring_cnt; ++cnt)
+	{
+		const slow_frame_t& frame = ring[cnt % slow_frame_ring_size];
+		fprintf(fh, "[%06lu] gap:%.1f ms draw:%.1f ms queue:%zu textures:%zu allocs:",
+			frame.tstamp_us / 1000, frame.gap_us / 1000., frame.draw_us / 1000.,
+			frame.queue_depth, frame.texture_cnt);
+		if (frame.alloc_tracked)
+			fprintf(fh, "%lu\n", frame.alloc_cnt);
+		else
+			fprintf(fh, "-\n");
+		fprintf(fh, "  pkt:%zu decode:%.1f ms", frame.pkt_cnt, frame.pkt_decode_ns / 1000000.);
+		for (size_t idx = 0; idx < frame.pkt_type_cnt; ++idx)
+		{
+			const slow_frame_t::pkt_type_cnt_t& type_cnt = frame.pkt_type_list[idx];
+			if (isalnum(type_cnt.type))
+				fprintf(fh, " %c:%u", type_cnt.type, type_cnt.count);
+			else
+				fprintf(fh, " 0x%02x:%u", type_cnt.type, type_cnt.count);
+		}
+		fprintf(fh, "\n ");
+		for (size_t idx = 0; idx < frame.stage_cnt; ++idx)
+		{
+			const profile_frame_stat_t& stage = frame.stage_list[idx];
+			fprintf(fh, " %s:%.2f", stage.name, stage.ns / 1000000.);
+			if (stage.count > 1)
+				fprintf(fh, "x%u", stage.count);
+		}
+		fprintf(fh, " ms\n");
+	}
+	ring_cnt = 0;
+	fflush(fh);
+}
@@ -0,0 +1,81 @@
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include "profile.h"
+
+#include <array>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Slow frame reports.
+// frame_end() after every present takes the zone times of the frame, a frame presented
+// slow_frame_factor budgets or more after the previous one is kept with its packets,
+// packet queue depth, created textures and allocations in a ring of the last
+// slow_frame_ring_size. dump() prints and empties the ring. The present to present gap
+// is the "frame_gap" profiler zone.
+
+static const size_t slow_frame_stage_max = 24;
+static const size_t slow_frame_pkt_type_max = 8;
+static const size_t slow_frame_ring_size = 32;
+static const uint64_t slow_frame_factor = 2;
+
+struct slow_frame_t
+{
+	struct pkt_type_cnt_t
+	{
+		uint8_t type;
+		uint32_t count;
+	};
+
+	uint64_t tstamp_us;  // run time at present
+	uint64_t gap_us;  // since the previous present
+	uint64_t draw_us;
+	profile_frame_stat_t stage_list[slow_frame_stage_max];
+	size_t stage_cnt;
+	size_t pkt_cnt;
+	uint64_t pkt_decode_ns;
+	pkt_type_cnt_t pkt_type_list[slow_frame_pkt_type_max];  // most frequent first
+	size_t pkt_type_cnt;
+	size_t queue_depth;
+	size_t texture_cnt;
+	uint64_t alloc_cnt;
+	bool alloc_tracked;
+};
+
+struct watchdog_t
+{
+	explicit watchdog_t(uint64_t budget_us_);
+
+	// every handled packet, from pkt_handle()
+	void pkt(uint8_t type, uint64_t decode_ns)
+	{
+		pkt_type_cnt_list[type]++;
+		pkt_cnt++;
+		pkt_decode_ns += decode_ns;
+	}
+
+	// right after present, texture_total - textures the screen created so far
+	void frame_end(uint64_t present_us, uint64_t draw_us, size_t texture_total);
+	void dump(FILE* fh);
+
+	uint64_t budget_us;
+	size_t queue_depth;  // packets waiting at the frame start, set by the frame loop
+	size_t frame_cnt;  // since start
+	size_t slow_cnt;
+	profile_hist_t gap_hist;  // present to present since start
+	// current frame
+	uint32_t pkt_type_cnt_list[256];
+	size_t pkt_cnt;
+	uint64_t pkt_decode_ns;
+	profile_frame_stat_t stage_list[slow_frame_stage_max];
+	// at the previous present
+	uint64_t present_prev_us;
+	size_t texture_total_prev;
+	uint64_t alloc_cnt_prev;
+	std::array<slow_frame_t, slow_frame_ring_size> ring;
+	size_t ring_cnt;  // written since the last dump
+};
+
+#endif  // WATCHDOG_H